@@ -264,6 +264,11 @@ void CGOpenGL::onKeyUp(CGKeyEvent *currentEvent)
 		controller.refreshPop();
 		currentEvent->setEventHandled();
 	}
+	else if(currentEvent->keyCode() == 'B')
+	{
+		controller.benchmark();
+		currentEvent->setEventHandled();
+	}
 	else if(currentEvent->keyCode() == VK_LEFT || currentEvent->keyCode() == VK_RIGHT)
 	{
 		controller.swapAI();
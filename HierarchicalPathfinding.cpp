@@ -0,0 +1,694 @@
+// ---------------------------------------------------------------------
+// HierarchicalPathfinding Implementation
+// ---------------------------------------------------------------------
+
+#include "HierarchicalPathfinding.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+// Namespace use
+using namespace std;
+using namespace CoreStructures;
+
+// Cost of a node that hasn't been reached yet
+#define UNREACHED 1.0e30f
+
+// Entrances shorter than this get one crossing (in the middle),
+// longer ones get one at each end
+#define WIDE_ENTRANCE 6
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Is Blocked (off the map counts as blocked)
+bool HierarchicalPathfinding::IsBlocked(int x, int z)
+{
+	return x < 0 || z < 0 || x >= width || z >= depth || isCellBlocked(x, z);
+}
+
+// Sector of a cell
+int HierarchicalPathfinding::SectorOf(int cell)
+{
+	return ((cell / width) / sectorSize) * sectorsX + (cell % width) / sectorSize;
+}
+
+// Sector Bounds (x1/z1 are one past the last cell)
+void HierarchicalPathfinding::SectorBounds(int sector, int& x0, int& z0, int& x1, int& z1)
+{
+	x0 = (sector % sectorsX) * sectorSize;
+	z0 = (sector / sectorsX) * sectorSize;
+	x1 = min(x0 + sectorSize, width);
+	z1 = min(z0 + sectorSize, depth);
+}
+
+// Add Entrances
+// An entrance of count open cells starting at first (cells step apart),
+// paired with the cells across the border
+void HierarchicalPathfinding::AddEntrances(vector<int>& border, int first, int count, int step, int across)
+{
+	if(count < WIDE_ENTRANCE)
+	{
+		int middle = first + (count / 2) * step;
+		border.push_back(middle);
+		border.push_back(middle + across);
+	}
+	else
+	{
+		int last = first + (count - 1) * step;
+		border.push_back(first);
+		border.push_back(first + across);
+		border.push_back(last);
+		border.push_back(last + across);
+	}
+}
+
+// Build Borders
+// Find the entrances on the sector's east and south borders
+void HierarchicalPathfinding::BuildBorders(int sector)
+{
+	int x0, z0, x1, z1;
+	SectorBounds(sector, x0, z0, x1, z1);
+
+	eastBorder[sector].clear();
+	southBorder[sector].clear();
+
+	// East border, runs of open cells down the last column
+	if(x1 < width)
+	{
+		int run = 0;
+
+		for(int z = z0; z <= z1; z += 1)
+		{
+			if(z < z1 && !IsBlocked(x1 - 1, z) && !IsBlocked(x1, z))
+			{
+				run += 1;
+			}
+			else if(run > 0)
+			{
+				AddEntrances(eastBorder[sector], (z - run) * width + x1 - 1, run, width, 1);
+				run = 0;
+			}
+		}
+	}
+
+	// South border, runs of open cells along the last row
+	if(z1 < depth)
+	{
+		int run = 0;
+
+		for(int x = x0; x <= x1; x += 1)
+		{
+			if(x < x1 && !IsBlocked(x, z1 - 1) && !IsBlocked(x, z1))
+			{
+				run += 1;
+			}
+			else if(run > 0)
+			{
+				AddEntrances(southBorder[sector], (z1 - 1) * width + x - run, run, 1, width);
+				run = 0;
+			}
+		}
+	}
+}
+
+// Build Sector
+// Collect the sector's entrance cells and the distances between them
+void HierarchicalPathfinding::BuildSector(int sector)
+{
+	vector<int>& cells = sectorCells[sector];
+	vector<int>& costs = sectorCosts[sector];
+
+	cells.clear();
+
+	int sx = sector % sectorsX;
+	int sz = sector / sectorsX;
+
+	// Own borders hold the first cell of each pair, the west and north
+	// neighbours' borders hold the second
+	for(unsigned int i = 0; i < eastBorder[sector].size(); i += 2)
+		cells.push_back(eastBorder[sector][i]);
+
+	for(unsigned int i = 0; i < southBorder[sector].size(); i += 2)
+		cells.push_back(southBorder[sector][i]);
+
+	if(sx > 0)
+		for(unsigned int i = 1; i < eastBorder[sector - 1].size(); i += 2)
+			cells.push_back(eastBorder[sector - 1][i]);
+
+	if(sz > 0)
+		for(unsigned int i = 1; i < southBorder[sector - sectorsX].size(); i += 2)
+			cells.push_back(southBorder[sector - sectorsX][i]);
+
+	// A corner cell can be on two borders
+	sort(cells.begin(), cells.end());
+	cells.erase(unique(cells.begin(), cells.end()), cells.end());
+
+	int n = cells.size();
+	costs.assign(n * n, -1);
+
+	for(int i = 0; i < n; i += 1)
+	{
+		SectorDistances(sector, cells[i]);
+
+		for(int j = 0; j < n; j += 1)
+		{
+			costs[i * n + j] = local[LocalIndex(sector, cells[j])];
+		}
+	}
+
+	rebuilt += 1;
+}
+
+// Renumber
+// Give every entrance cell its abstract node number
+void HierarchicalPathfinding::Renumber()
+{
+	for(unsigned int i = 0; i < nodeCell.size(); i += 1)
+	{
+		cellNode[nodeCell[i]] = -1;
+	}
+
+	nodeCell.clear();
+	nodeLocal.clear();
+
+	for(unsigned int s = 0; s < sectorCells.size(); s += 1)
+	{
+		for(unsigned int i = 0; i < sectorCells[s].size(); i += 1)
+		{
+			cellNode[sectorCells[s][i]] = nodeCell.size();
+			nodeCell.push_back(sectorCells[s][i]);
+			nodeLocal.push_back(i);
+		}
+	}
+
+	// Scratch for the abstract nodes plus the start and goal. Stamps
+	// left by the old numbering are all older than the next search.
+	costG.resize(nodeCell.size() + 2, UNREACHED);
+	parent.resize(nodeCell.size() + 2, -1);
+	stamp.resize(nodeCell.size() + 2, 0);
+}
+
+// Update
+// Rebuild the dirty sectors. A changed cell can change the entrances
+// on any of its sector's borders, and so the entrance cells of the
+// neighbouring sectors.
+void HierarchicalPathfinding::Update()
+{
+	if(!anyDirty)
+	{
+		return;
+	}
+
+	int sectors = sectorsX * sectorsZ;
+	vector<bool> borders(sectors, false);
+	vector<bool> rebuild(sectors, false);
+
+	for(int s = 0; s < sectors; s += 1)
+	{
+		if(!dirty[s])
+		{
+			continue;
+		}
+
+		int sx = s % sectorsX;
+		int sz = s / sectorsX;
+
+		borders[s] = true;
+		rebuild[s] = true;
+
+		if(sx > 0)
+		{
+			borders[s - 1] = true;
+			rebuild[s - 1] = true;
+		}
+
+		if(sz > 0)
+		{
+			borders[s - sectorsX] = true;
+			rebuild[s - sectorsX] = true;
+		}
+
+		if(sx < sectorsX - 1)
+			rebuild[s + 1] = true;
+
+		if(sz < sectorsZ - 1)
+			rebuild[s + sectorsX] = true;
+
+		dirty[s] = false;
+	}
+
+	for(int s = 0; s < sectors; s += 1)
+		if(borders[s])
+			BuildBorders(s);
+
+	for(int s = 0; s < sectors; s += 1)
+		if(rebuild[s])
+			BuildSector(s);
+
+	Renumber();
+	anyDirty = false;
+}
+
+// Sector Distances
+// Breadth first search from cell, leaves the distance to every cell of
+// the sector in local (-1 == unreachable)
+void HierarchicalPathfinding::SectorDistances(int sector, int cell)
+{
+	int x0, z0, x1, z1;
+	SectorBounds(sector, x0, z0, x1, z1);
+
+	local.assign(sectorSize * sectorSize, -1);
+	queue.clear();
+
+	local[LocalIndex(sector, cell)] = 0;
+	queue.push_back(cell);
+
+	for(unsigned int head = 0; head < queue.size(); head += 1)
+	{
+		int x = queue[head] % width;
+		int z = queue[head] / width;
+		int distance = local[(z - z0) * sectorSize + (x - x0)] + 1;
+
+		int nx[4] = { x + 1, x - 1, x, x };
+		int nz[4] = { z, z, z + 1, z - 1 };
+
+		for(int i = 0; i < 4; i += 1)
+		{
+			if(nx[i] < x0 || nz[i] < z0 || nx[i] >= x1 || nz[i] >= z1)
+				continue;
+
+			int index = (nz[i] - z0) * sectorSize + (nx[i] - x0);
+
+			if(local[index] < 0 && !isCellBlocked(nx[i], nz[i]))
+			{
+				local[index] = distance;
+				queue.push_back(nz[i] * width + nx[i]);
+			}
+		}
+	}
+}
+
+// Local Index (of a cell in its sector's distances)
+int HierarchicalPathfinding::LocalIndex(int sector, int cell)
+{
+	int x0, z0, x1, z1;
+	SectorBounds(sector, x0, z0, x1, z1);
+
+	return ((cell / width) - z0) * sectorSize + ((cell % width) - x0);
+}
+
+// Heuristic (Manhatten distance to the goal)
+float HierarchicalPathfinding::Heuristic(int cell)
+{
+	return (float)(abs(cell % width - goalCell % width) + abs(cell / width - goalCell / width));
+}
+
+// Relax
+// Open node id if G is a cheaper way to it
+void HierarchicalPathfinding::Relax(int id, float G, int from, int cell)
+{
+	if(stamp[id] != search)
+	{
+		stamp[id] = search;
+		costG[id] = UNREACHED;
+		parent[id] = -1;
+	}
+
+	if(G < costG[id])
+	{
+		costG[id] = G;
+		parent[id] = from;
+
+		OpenEntry entry;
+		entry.F = G + Heuristic(cell);
+		entry.G = G;
+		entry.ID = id;
+
+		open.push_back(entry);
+		push_heap(open.begin(), open.end());
+	}
+}
+
+// Refine Segment
+// Fill refined with the cells after abstractPath[index] up to and
+// including abstractPath[index + 1]. Both are in one sector, or are
+// neighbours across a border.
+void HierarchicalPathfinding::RefineSegment(int index)
+{
+	int from = abstractPath[index];
+	int to = abstractPath[index + 1];
+
+	refined.clear();
+	refinedIndex = 0;
+
+	if(from == to)
+	{
+		return;
+	}
+
+	int dx = abs(from % width - to % width);
+	int dz = abs(from / width - to / width);
+
+	if(dx + dz == 1)
+	{
+		refined.push_back(to);
+		return;
+	}
+
+	// Walk downhill on the distances from the far end
+	int sector = SectorOf(to);
+	SectorDistances(sector, to);
+
+	int x0, z0, x1, z1;
+	SectorBounds(sector, x0, z0, x1, z1);
+
+	int cell = from;
+
+	while(cell != to)
+	{
+		int x = cell % width;
+		int z = cell / width;
+		int distance = local[LocalIndex(sector, cell)];
+
+		int nx[4] = { x + 1, x - 1, x, x };
+		int nz[4] = { z, z, z + 1, z - 1 };
+
+		for(int i = 0; i < 4; i += 1)
+		{
+			if(nx[i] < x0 || nz[i] < z0 || nx[i] >= x1 || nz[i] >= z1)
+				continue;
+
+			if(local[(nz[i] - z0) * sectorSize + (nx[i] - x0)] == distance - 1)
+			{
+				cell = nz[i] * width + nx[i];
+				break;
+			}
+		}
+
+		refined.push_back(cell);
+	}
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+HierarchicalPathfinding::HierarchicalPathfinding()
+{
+	endFound = 0;
+	expanded = 0;
+	pathLength = -1;
+	rebuilt = 0;
+	search = 0;
+	anyDirty = false;
+
+	startCell = 0;
+	goalCell = 0;
+	segment = 0;
+	refinedIndex = 0;
+	walking = false;
+
+	isCellBlocked = NULL;
+
+	setMapSize(WORLD_SIZE, WORLD_SIZE);
+}
+
+// Deconstructor
+HierarchicalPathfinding::~HierarchicalPathfinding()
+{
+	// EMPTY
+}
+
+// Attach checker function
+void HierarchicalPathfinding::attachMapCheck(checkMap func)
+{
+	isCellBlocked = func;
+
+	// Every sector was built against the old checker
+	dirty.assign(dirty.size(), true);
+	anyDirty = true;
+}
+
+// Set map size
+void HierarchicalPathfinding::setMapSize(int width, int depth, int sectorSize)
+{
+	this->width = width;
+	this->depth = depth;
+	this->sectorSize = sectorSize;
+
+	sectorsX = (width + sectorSize - 1) / sectorSize;
+	sectorsZ = (depth + sectorSize - 1) / sectorSize;
+
+	int sectors = sectorsX * sectorsZ;
+
+	eastBorder.assign(sectors, vector<int>());
+	southBorder.assign(sectors, vector<int>());
+	sectorCells.assign(sectors, vector<int>());
+	sectorCosts.assign(sectors, vector<int>());
+
+	nodeCell.clear();
+	nodeLocal.clear();
+	cellNode.assign(width * depth, -1);
+
+	// Everything is built by the next query
+	dirty.assign(sectors, true);
+	anyDirty = true;
+	rebuilt = 0;
+
+	abstractPath.clear();
+	endFound = 0;
+}
+
+// Build
+// Precondition: Map checker attached
+// Postcondition: Abstract graph built for every dirty sector
+void HierarchicalPathfinding::Build()
+{
+	Update();
+}
+
+// Cell Changed
+// Precondition: The cell at x, z has been walled or cleared
+// Postcondition: Its sector is rebuilt by the next query
+void HierarchicalPathfinding::CellChanged(int x, int z)
+{
+	if(x < 0 || z < 0 || x >= width || z >= depth)
+	{
+		return;
+	}
+
+	dirty[SectorOf(z * width + x)] = true;
+	anyDirty = true;
+}
+
+// Find Path
+void HierarchicalPathfinding::FindPath(GUVector4 currentPos, GUVector4 endPos)
+{
+	Update();
+
+	abstractPath.clear();
+	open.clear();
+	goalLinks.clear();
+	endFound = 0;
+	expanded = 0;
+	pathLength = -1;
+	ResetPath();
+
+	int sx = (int)currentPos.x;
+	int sz = (int)currentPos.z;
+	int ex = (int)endPos.x;
+	int ez = (int)endPos.z;
+
+	if(IsBlocked(sx, sz) || IsBlocked(ex, ez))
+	{
+		return;
+	}
+
+	startCell = sz * width + sx;
+	goalCell = ez * width + ex;
+
+	int startSector = SectorOf(startCell);
+	int goalSector = SectorOf(goalCell);
+
+	// Search number wrapped round, old scratch would look current
+	search += 1;
+
+	if(search == 0)
+	{
+		stamp.assign(stamp.size(), 0);
+		search = 1;
+	}
+
+	int START = nodeCell.size();
+	int GOAL = START + 1;
+
+	// Goal to the entrances of its sector
+	SectorDistances(goalSector, goalCell);
+
+	for(unsigned int i = 0; i < sectorCells[goalSector].size(); i += 1)
+	{
+		int distance = local[LocalIndex(goalSector, sectorCells[goalSector][i])];
+
+		if(distance >= 0)
+		{
+			goalLinks.push_back(cellNode[sectorCells[goalSector][i]]);
+			goalLinks.push_back(distance);
+		}
+	}
+
+	Relax(START, 0, -1, startCell);
+
+	while(!open.empty())
+	{
+		pop_heap(open.begin(), open.end());
+		OpenEntry entry = open.back();
+		open.pop_back();
+
+		// Skip entries that have been bettered since they were pushed
+		if(entry.G != costG[entry.ID])
+		{
+			continue;
+		}
+
+		if(entry.ID == GOAL)
+		{
+			break;
+		}
+
+		expanded += 1;
+
+		if(entry.ID == START)
+		{
+			// Start to the entrances of its sector, or straight to a goal
+			// in the same sector
+			SectorDistances(startSector, startCell);
+
+			for(unsigned int i = 0; i < sectorCells[startSector].size(); i += 1)
+			{
+				int cell = sectorCells[startSector][i];
+				int distance = local[LocalIndex(startSector, cell)];
+
+				if(distance >= 0)
+					Relax(cellNode[cell], (float)distance, START, cell);
+			}
+
+			if(startSector == goalSector && local[LocalIndex(startSector, goalCell)] >= 0)
+			{
+				Relax(GOAL, (float)local[LocalIndex(startSector, goalCell)], START, goalCell);
+			}
+
+			continue;
+		}
+
+		int cell = nodeCell[entry.ID];
+		int sector = SectorOf(cell);
+		int n = sectorCells[sector].size();
+		int i = nodeLocal[entry.ID];
+
+		// Other entrances of the sector
+		for(int j = 0; j < n; j += 1)
+		{
+			int cost = sectorCosts[sector][i * n + j];
+
+			if(cost > 0)
+				Relax(cellNode[sectorCells[sector][j]], entry.G + cost, entry.ID, sectorCells[sector][j]);
+		}
+
+		// Entrances across a border
+		int x = cell % width;
+		int z = cell / width;
+		int nx[4] = { x + 1, x - 1, x, x };
+		int nz[4] = { z, z, z + 1, z - 1 };
+
+		for(int k = 0; k < 4; k += 1)
+		{
+			if(IsBlocked(nx[k], nz[k]))
+				continue;
+
+			int other = nz[k] * width + nx[k];
+
+			if(cellNode[other] >= 0 && SectorOf(other) != sector)
+				Relax(cellNode[other], entry.G + 1, entry.ID, other);
+		}
+
+		// The goal
+		if(sector == goalSector)
+		{
+			for(unsigned int k = 0; k < goalLinks.size(); k += 2)
+			{
+				if(goalLinks[k] == entry.ID)
+					Relax(GOAL, entry.G + goalLinks[k + 1], entry.ID, goalCell);
+			}
+		}
+	}
+
+	if(stamp[GOAL] != search || costG[GOAL] == UNREACHED)
+	{
+		return;
+	}
+
+	// Abstract path, goal first then reversed
+	for(int id = GOAL; id != -1; id = parent[id])
+	{
+		if(id == GOAL)
+			abstractPath.push_back(goalCell);
+		else if(id == START)
+			abstractPath.push_back(startCell);
+		else
+			abstractPath.push_back(nodeCell[id]);
+	}
+
+	reverse(abstractPath.begin(), abstractPath.end());
+
+	pathLength = (int)costG[GOAL];
+	endFound = 1;
+}
+
+// Next Path Position
+// The path is refined a segment at a time as it's walked
+GUVector4 HierarchicalPathfinding::GetNextPosition()
+{
+	if(abstractPath.empty())
+	{
+		return GUVector4(0.0, 0.0, 0.0);
+	}
+
+	int cell = abstractPath[0];
+
+	if(!walking)
+	{
+		walking = true;
+	}
+	else
+	{
+		while(refinedIndex >= (int)refined.size() && segment + 1 < (int)abstractPath.size())
+		{
+			RefineSegment(segment);
+			segment += 1;
+		}
+
+		if(refinedIndex < (int)refined.size())
+		{
+			cell = refined[refinedIndex];
+			refinedIndex += 1;
+		}
+		else
+		{
+			cell = abstractPath.back();
+		}
+	}
+
+	return GUVector4(cell % width, 0, cell / width);
+}
+
+// Reset path
+void HierarchicalPathfinding::ResetPath()
+{
+	refined.clear();
+	refinedIndex = 0;
+	segment = 0;
+	walking = false;
+}
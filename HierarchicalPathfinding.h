@@ -0,0 +1,176 @@
+#pragma once
+#ifndef HIERARCHICALPATHFINDING
+#define HIERARCHICALPATHFINDING
+
+// Includes
+#include "Pathfinding.h"
+
+#include <vector>
+#include <CoreStructures\GUVector4.h>
+
+// ---------------------------------------------------------------------
+// HierarchicalPathfinding - HPA* for large maps. The map is split into
+// square sectors, and the cells where a path can cross from one sector
+// to the next (entrances) form an abstract graph whose edges are the
+// shortest distances between entrances inside a sector. A query
+// searches the abstract graph, and the cell by cell path is only
+// worked out one sector at a time as it is walked. Paths are close to,
+// but not always, the shortest.
+// ---------------------------------------------------------------------
+
+class HierarchicalPathfinding
+{
+private:
+
+	// Open list entry (see Pathfinding)
+	struct OpenEntry
+	{
+		float F;
+		float G;
+		int ID;
+
+		bool operator<(const OpenEntry& e) const
+		{
+			if(F != e.F)
+				return F > e.F;
+
+			return G < e.G;
+		}
+	};
+
+	// ATTRIBUTES
+
+	// Map dimensions
+	int width;
+	int depth;
+
+	// Sector size (cells per side) and number of sectors
+	int sectorSize;
+	int sectorsX;
+	int sectorsZ;
+
+	// Entrances on each sector's east and south borders, as pairs of
+	// cells (one inside the sector, one across the border)
+	std::vector< std::vector<int> > eastBorder;
+	std::vector< std::vector<int> > southBorder;
+
+	// Entrance cells of each sector and the distance between every
+	// pair of them without leaving the sector (-1 == no path)
+	std::vector< std::vector<int> > sectorCells;
+	std::vector< std::vector<int> > sectorCosts;
+
+	// Sectors with changed cells, rebuilt before the next query
+	std::vector<bool> dirty;
+	bool anyDirty;
+
+	// Abstract graph, one node per entrance cell
+	std::vector<int> nodeCell;
+	std::vector<int> nodeLocal; // index in sectorCells
+	std::vector<int> cellNode; // -1 == not an entrance
+
+	// Search scratch (abstract nodes, then start and goal)
+	std::vector<float> costG;
+	std::vector<int> parent;
+	std::vector<unsigned int> stamp;
+	std::vector<OpenEntry> open;
+	unsigned int search;
+
+	// Query ends and their distances to their sector's entrances
+	int startCell;
+	int goalCell;
+	std::vector<int> goalLinks; // pairs (node, distance)
+
+	// Distances within one sector (breadth first search scratch)
+	std::vector<int> local;
+	std::vector<int> queue;
+
+	// Abstract path (cells, start first) and the refined cells of the
+	// segment being walked
+	std::vector<int> abstractPath;
+	std::vector<int> refined;
+	int segment;
+	int refinedIndex;
+	bool walking;
+
+	// Statistics
+	int expanded;
+	int pathLength;
+	int rebuilt;
+
+	// Map Checker function
+	checkMap isCellBlocked;
+
+	// METHODS
+
+	bool IsBlocked(int x, int z);
+	int SectorOf(int cell);
+	void SectorBounds(int sector, int& x0, int& z0, int& x1, int& z1);
+
+	// Building
+	void AddEntrances(std::vector<int>& border, int first, int count, int step, int across);
+	void BuildBorders(int sector);
+	void BuildSector(int sector);
+	void Renumber();
+	void Update();
+
+	// Breadth first search from a cell without leaving its sector
+	void SectorDistances(int sector, int cell);
+	int LocalIndex(int sector, int cell);
+
+	// Abstract search
+	float Heuristic(int cell);
+	void Relax(int id, float G, int from, int cell);
+
+	// Work out the cells between two abstract path cells
+	void RefineSegment(int index);
+
+public:
+
+	// ATTRIBUTES
+
+	// Has the end node been found?
+	bool endFound;
+
+	// METHODS
+
+	// Constructor/Deconstructor
+	HierarchicalPathfinding();
+	~HierarchicalPathfinding();
+
+	// Attach checker function
+	void attachMapCheck(checkMap func);
+
+	// Set the map and sector dimensions, the graph is rebuilt by the
+	// next query (or Build)
+	void setMapSize(int width, int depth, int sectorSize = 16);
+
+	// Build the whole abstract graph now
+	void Build();
+
+	// A cell has changed, only its sector (and its neighbours'
+	// entrances) are rebuilt
+	void CellChanged(int x, int z);
+
+	// Find a path from the start to the end
+	void FindPath(CoreStructures::GUVector4 currentPos, CoreStructures::GUVector4 endPos);
+
+	// Return the next path position
+	CoreStructures::GUVector4 GetNextPosition();
+
+	// Reset to the start of the path
+	void ResetPath();
+
+	// Abstract nodes expanded by the last search
+	int getExpanded() { return expanded; }
+
+	// Length of the last path found (moves, -1 if none)
+	int getPathLength() { return pathLength; }
+
+	// Abstract nodes in the graph
+	int getNodes() { return (int)nodeCell.size(); }
+
+	// Sectors rebuilt since the map size was set
+	int getRebuilt() { return rebuilt; }
+};
+
+#endif
@@ -0,0 +1,401 @@
+// ---------------------------------------------------------------------
+// IncrementalPathfinding Implementation
+// ---------------------------------------------------------------------
+
+#include "IncrementalPathfinding.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+// Namespace use
+using namespace std;
+using namespace CoreStructures;
+
+// Cost of a cell that can't reach the goal
+#define UNREACHED 0x3fffffff
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Is Blocked
+bool IncrementalPathfinding::IsBlocked(int cell)
+{
+	return isCellBlocked(cell % width, cell / width);
+}
+
+// Heuristic (Manhatten distance)
+int IncrementalPathfinding::Heuristic(int a, int b)
+{
+	return abs(a % width - b % width) + abs(a / width - b / width);
+}
+
+// Initialise
+// Forget the previous search, only the goal is consistent
+void IncrementalPathfinding::Initialise()
+{
+	costG.assign(width * depth, UNREACHED);
+	costRHS.assign(width * depth, UNREACHED);
+	inOpen.assign(width * depth, false);
+	openK1.assign(width * depth, 0);
+	openK2.assign(width * depth, 0);
+	open.clear();
+	changed.clear();
+
+	km = 0;
+	lastCell = startCell;
+
+	costRHS[goalCell] = 0;
+	UpdateVertex(goalCell);
+
+	initialised = 1;
+}
+
+// Calculate Key
+void IncrementalPathfinding::CalculateKey(int cell, int& k1, int& k2)
+{
+	k2 = min(costG[cell], costRHS[cell]);
+	k1 = (k2 >= UNREACHED) ? UNREACHED : k2 + Heuristic(startCell, cell) + km;
+}
+
+// Update Vertex
+// Recompute the cell's rhs from its neighbours and (re)queue it if
+// it's inconsistent
+void IncrementalPathfinding::UpdateVertex(int cell)
+{
+	if(cell != goalCell)
+	{
+		touched += 1;
+
+		int rhs = UNREACHED;
+
+		if(!IsBlocked(cell))
+		{
+			int x = cell % width;
+			int z = cell / width;
+
+			if(x + 1 < width && !IsBlocked(cell + 1))
+				rhs = min(rhs, costG[cell + 1] + 1);
+
+			if(x > 0 && !IsBlocked(cell - 1))
+				rhs = min(rhs, costG[cell - 1] + 1);
+
+			if(z + 1 < depth && !IsBlocked(cell + width))
+				rhs = min(rhs, costG[cell + width] + 1);
+
+			if(z > 0 && !IsBlocked(cell - width))
+				rhs = min(rhs, costG[cell - width] + 1);
+		}
+
+		costRHS[cell] = min(rhs, UNREACHED);
+	}
+
+	if(costG[cell] != costRHS[cell])
+	{
+		OpenEntry entry;
+		CalculateKey(cell, entry.K1, entry.K2);
+		entry.ID = cell;
+
+		// Already queued with this key
+		if(inOpen[cell] && openK1[cell] == entry.K1 && openK2[cell] == entry.K2)
+		{
+			return;
+		}
+
+		inOpen[cell] = true;
+		openK1[cell] = entry.K1;
+		openK2[cell] = entry.K2;
+
+		open.push_back(entry);
+		push_heap(open.begin(), open.end());
+	}
+	else
+	{
+		inOpen[cell] = false;
+	}
+}
+
+// Top Key
+// Drop stale entries, then return the smallest key (false if empty)
+bool IncrementalPathfinding::TopKey(int& k1, int& k2)
+{
+	while(!open.empty())
+	{
+		const OpenEntry& top = open.front();
+
+		if(inOpen[top.ID] && openK1[top.ID] == top.K1 && openK2[top.ID] == top.K2)
+		{
+			k1 = top.K1;
+			k2 = top.K2;
+			return true;
+		}
+
+		pop_heap(open.begin(), open.end());
+		open.pop_back();
+	}
+
+	k1 = UNREACHED;
+	k2 = UNREACHED;
+	return false;
+}
+
+// Compute Shortest Path
+// Expand inconsistent cells until the start is consistent and nothing
+// queued could give it a cheaper path
+void IncrementalPathfinding::ComputeShortestPath()
+{
+	int k1, k2;
+	int s1, s2;
+
+	while(TopKey(k1, k2))
+	{
+		CalculateKey(startCell, s1, s2);
+
+		if((k1 > s1 || (k1 == s1 && k2 >= s2)) && costRHS[startCell] == costG[startCell])
+		{
+			break;
+		}
+
+		int cell = open.front().ID;
+		pop_heap(open.begin(), open.end());
+		open.pop_back();
+		inOpen[cell] = false;
+
+		expanded += 1;
+
+		// The start moved since it was queued, queue it again
+		int n1, n2;
+		CalculateKey(cell, n1, n2);
+
+		if(k1 < n1 || (k1 == n1 && k2 < n2))
+		{
+			UpdateVertex(cell);
+			continue;
+		}
+
+		if(costG[cell] > costRHS[cell])
+		{
+			// Overconsistent, the cheaper cost is now settled
+			costG[cell] = costRHS[cell];
+		}
+		else
+		{
+			// Underconsistent, raise it and recompute it with the rest
+			costG[cell] = UNREACHED;
+			UpdateVertex(cell);
+		}
+
+		int x = cell % width;
+		int z = cell / width;
+
+		if(x + 1 < width)
+			UpdateVertex(cell + 1);
+
+		if(x > 0)
+			UpdateVertex(cell - 1);
+
+		if(z + 1 < depth)
+			UpdateVertex(cell + width);
+
+		if(z > 0)
+			UpdateVertex(cell - width);
+	}
+}
+
+// Extract Path
+// Follow the cheapest neighbours from the start down to the goal
+void IncrementalPathfinding::ExtractPath()
+{
+	path.clear();
+	current = 0;
+
+	if(costG[startCell] >= UNREACHED)
+	{
+		return;
+	}
+
+	int cell = startCell;
+	path.push_back(cell);
+
+	while(cell != goalCell)
+	{
+		int x = cell % width;
+		int z = cell / width;
+		int next = cell;
+
+		if(x + 1 < width && !IsBlocked(cell + 1) && costG[cell + 1] < costG[next])
+			next = cell + 1;
+
+		if(x > 0 && !IsBlocked(cell - 1) && costG[cell - 1] < costG[next])
+			next = cell - 1;
+
+		if(z + 1 < depth && !IsBlocked(cell + width) && costG[cell + width] < costG[next])
+			next = cell + width;
+
+		if(z > 0 && !IsBlocked(cell - width) && costG[cell - width] < costG[next])
+			next = cell - width;
+
+		// No way down (can't happen once the search is consistent)
+		if(next == cell)
+		{
+			path.clear();
+			return;
+		}
+
+		cell = next;
+		path.push_back(cell);
+	}
+
+	endFound = 1;
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+IncrementalPathfinding::IncrementalPathfinding()
+{
+	endFound = 0;
+	expanded = 0;
+	touched = 0;
+	current = 0;
+	km = 0;
+
+	startCell = 0;
+	goalCell = 0;
+	lastCell = 0;
+	initialised = 0;
+
+	isCellBlocked = NULL;
+
+	setMapSize(WORLD_SIZE, WORLD_SIZE);
+}
+
+// Deconstructor
+IncrementalPathfinding::~IncrementalPathfinding()
+{
+	// EMPTY
+}
+
+// Attach checker function
+void IncrementalPathfinding::attachMapCheck(checkMap func)
+{
+	isCellBlocked = func;
+	initialised = 0;
+}
+
+// Set map size
+void IncrementalPathfinding::setMapSize(int width, int depth)
+{
+	this->width = width;
+	this->depth = depth;
+
+	initialised = 0;
+	path.clear();
+	changed.clear();
+	current = 0;
+}
+
+// Cell Changed
+// Precondition: The cell at x, z has been walled or cleared
+// Postcondition: The search is repaired around it by the next query
+void IncrementalPathfinding::CellChanged(int x, int z)
+{
+	if(initialised && x >= 0 && z >= 0 && x < width && z < depth)
+	{
+		changed.push_back(z * width + x);
+	}
+}
+
+// Find Path
+void IncrementalPathfinding::FindPath(GUVector4 currentPos, GUVector4 endPos)
+{
+	int sx = (int)currentPos.x;
+	int sz = (int)currentPos.z;
+	int ex = (int)endPos.x;
+	int ez = (int)endPos.z;
+
+	expanded = 0;
+	touched = 0;
+	endFound = 0;
+	path.clear();
+	current = 0;
+
+	// Nothing to do if either end is off the map
+	if(sx < 0 || sz < 0 || sx >= width || sz >= depth || ex < 0 || ez < 0 || ex >= width || ez >= depth)
+	{
+		return;
+	}
+
+	startCell = sz * width + sx;
+
+	// A new goal means a new search, otherwise repair the old one
+	if(!initialised || goalCell != ez * width + ex)
+	{
+		goalCell = ez * width + ex;
+		Initialise();
+	}
+	else
+	{
+		// Keys made for the old start are too low by up to this much
+		km += Heuristic(lastCell, startCell);
+		lastCell = startCell;
+
+		// A changed cell changes the cost of every move into or out of it
+		for(unsigned int i = 0; i < changed.size(); i += 1)
+		{
+			int cell = changed[i];
+			int x = cell % width;
+			int z = cell / width;
+
+			UpdateVertex(cell);
+
+			if(x + 1 < width)
+				UpdateVertex(cell + 1);
+
+			if(x > 0)
+				UpdateVertex(cell - 1);
+
+			if(z + 1 < depth)
+				UpdateVertex(cell + width);
+
+			if(z > 0)
+				UpdateVertex(cell - width);
+		}
+
+		changed.clear();
+	}
+
+	if(IsBlocked(startCell) || IsBlocked(goalCell))
+	{
+		return;
+	}
+
+	ComputeShortestPath();
+	ExtractPath();
+}
+
+// Next Path Position
+GUVector4 IncrementalPathfinding::GetNextPosition()
+{
+	if(path.empty())
+	{
+		return GUVector4(startCell % width, 0, startCell / width);
+	}
+
+	int cell = path[current];
+
+	if(current + 1 < (int)path.size())
+	{
+		current += 1;
+	}
+
+	return GUVector4(cell % width, 0, cell / width);
+}
+
+// Reset path
+void IncrementalPathfinding::ResetPath()
+{
+	current = 0;
+}
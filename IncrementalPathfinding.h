@@ -0,0 +1,135 @@
+#pragma once
+#ifndef INCREMENTALPATHFINDING
+#define INCREMENTALPATHFINDING
+
+// Includes
+#include "Pathfinding.h"
+
+#include <vector>
+#include <CoreStructures\GUVector4.h>
+
+// ---------------------------------------------------------------------
+// IncrementalPathfinding - D* Lite. The search runs backwards from the
+// goal and is kept between queries, so when cells change (or the start
+// moves along the path) only the part of the search that the change
+// affects is repaired, rather than searching again from scratch.
+// ---------------------------------------------------------------------
+
+class IncrementalPathfinding
+{
+private:
+
+	// Open list entry. Entries aren't removed when a cell's key
+	// changes, they're skipped when popped if the key is out of date.
+	struct OpenEntry
+	{
+		int K1;
+		int K2;
+		int ID;
+
+		// Order for the heap: smallest key first
+		bool operator<(const OpenEntry& e) const
+		{
+			if(K1 != e.K1)
+				return K1 > e.K1;
+
+			return K2 > e.K2;
+		}
+	};
+
+	// ATTRIBUTES
+
+	// Map dimensions
+	int width;
+	int depth;
+
+	// Cost from each cell to the goal (g) and the one step lookahead
+	// of it (rhs), a cell is consistent when they're equal
+	std::vector<int> costG;
+	std::vector<int> costRHS;
+
+	// Open list (binary heap) and the key each open cell is queued with
+	std::vector<OpenEntry> open;
+	std::vector<bool> inOpen;
+	std::vector<int> openK1;
+	std::vector<int> openK2;
+
+	// Ends of the search, and the start the keys were last made for
+	int startCell;
+	int goalCell;
+	int lastCell;
+	bool initialised;
+
+	// Key modifier (the heuristic drop from the start moving)
+	int km;
+
+	// Cells changed since the last query
+	std::vector<int> changed;
+
+	// Path (cells, start first)
+	std::vector<int> path;
+	int current;
+
+	// Statistics for the last query
+	int expanded;
+	int touched;
+
+	// Map Checker function
+	checkMap isCellBlocked;
+
+	// METHODS
+
+	bool IsBlocked(int cell);
+	int Heuristic(int a, int b);
+
+	// D* Lite
+	void Initialise();
+	void CalculateKey(int cell, int& k1, int& k2);
+	void UpdateVertex(int cell);
+	bool TopKey(int& k1, int& k2);
+	void ComputeShortestPath();
+	void ExtractPath();
+
+public:
+
+	// ATTRIBUTES
+
+	// Has the end node been found?
+	bool endFound;
+
+	// METHODS
+
+	// Constructor/Deconstructor
+	IncrementalPathfinding();
+	~IncrementalPathfinding();
+
+	// Attach checker function
+	void attachMapCheck(checkMap func);
+
+	// Set the map dimensions (WORLD_SIZE x WORLD_SIZE by default)
+	void setMapSize(int width, int depth);
+
+	// A cell has been walled or cleared, repaired by the next query
+	void CellChanged(int x, int z);
+
+	// Find a path from the start to the end. With the same end as the
+	// last query the previous search is repaired, not repeated.
+	void FindPath(CoreStructures::GUVector4 currentPos, CoreStructures::GUVector4 endPos);
+
+	// Return the next path position
+	CoreStructures::GUVector4 GetNextPosition();
+
+	// Reset to the start of the path
+	void ResetPath();
+
+	// Cells expanded by the last query
+	int getExpanded() { return expanded; }
+
+	// Cells whose rhs was recomputed by the last query
+	int getTouched() { return touched; }
+
+	// Length of the last path found (moves, -1 if none)
+	int getPathLength() { return (int)path.size() - 1; }
+};
+
+#endif
@@ -21,8 +21,13 @@ public:
 	float G; // Cost from start node
 	float H; // Heuristic distance to goal
 
-	Node() : parent(0) {}; // Default constructor ( : parent(0) is same as {parent = 0;})
-	Node(int x, int z, Node *_parent = 0) : x(x), z(z), parent(_parent), ID(z * WORLD_SIZE + x), G(0), H(0) {};
+	// Search bookkeeping, the node is only valid for the search
+	// whose number matches (saves clearing every node per search)
+	unsigned int search;
+	bool closed;
+
+	Node() : parent(0), search(0), closed(0) {}; // Default constructor ( : parent(0) is same as {parent = 0;})
+	Node(int x, int z, Node *_parent = 0) : x(x), z(z), ID(z * WORLD_SIZE + x), parent(_parent), G(0), H(0), search(0), closed(0) {};
 
 	float getF() { return G + H; };
 
@@ -7,6 +7,10 @@
 
 // Other includes
 #include "random.h"
+#include "PCycleDetector.h"
+#include "PGrid.h"
+#include "PMapGenerator.h"
+#include "PFitnessCases.h"
 
 #include <time.h>
 #include <iostream>
@@ -16,17 +20,97 @@
 using namespace CoreStructures;
 using namespace std;
 
+// Default desert size, ants, grains of each colour and program runs per
+// ant (each can be changed before initialise)
+#define DESERT_WIDTH 20
+#define DESERT_DEPTH 20
+#define DESERT_ANTS 20
+#define DESERT_GRAINS 20
+#define DESERT_STEPS 300
+
+// Ants run each generation (0 == all of them)
+#define DESERT_ANT_SAMPLE 0
+
+// Steps between the snapshots offspring resume from (0 == off)
+#define DESERT_SNAPSHOTS 0
+
 // Static varibles (for fitness evaluation)
-static int startMap[20][20];
-static int map[20][20];
-static int renderMap[20][20];
-static GUVector4 antPos[20];
+static PGrid startMap;
+static PGrid map;
+static PGrid renderMap;
+static vector<GUVector4> antPos;
+
+// Program runs per ant
+static int steps = DESERT_STEPS;
+
+// Cells changed on map since it was last reset (only they need putting
+// back), mapCopied is false until map has been copied from startMap
+static vector<int> changed;
+static vector<char> changedColour;
+static bool mapCopied = 0;
+
+// Score of the sand where it lies on map, kept up to date as grains are
+// moved (startScore is startMap's), and of the ants' moves so far this
+// evaluation
+static float startScore = 0;
+static float sandScore = 0;
+static float moveScore = 0;
 
 // Data collection
-static std::vector<char> actions[20];
+static vector< vector<char> > actions;
 static int collectIndex = 0;
 static bool collectData = 0;
 
+// Repeated ant states between runs (cycle detection mode)
+// mapVersion changes whenever sand is moved on the map
+static bool detectCycles = 1;
+static PCycleDetector* cycles = NULL;
+static unsigned int mapVersion = 0;
+
+// Ants run this generation, each ant is a fitness case (they share the
+// map, so they're run in turn rather than on the case threads)
+static PFitnessCases antCases;
+
+// Run every ant a step at a time (simultaneous mode), rather than each
+// ant all the way through before the next. Cycle detection is only done
+// one ant at a time, in this mode the state is every ant's.
+static bool simultaneous = 0;
+
+// State of each ant in simultaneous mode, one array per terminal
+static vector<float> antX;
+static vector<float> antY;
+static vector<float> antCarrying;
+static vector<float> antColour;
+static vector<int> antIndex;
+
+// A point a run can be carried on from: the clock (program runs so far),
+// the sand moves made, the move score, the ant (its place in the run
+// order) and step about to run, and the terminals (X, Y, CARRYING then
+// COLOUR, of every ant in simultaneous mode)
+struct DesertSnapshot
+{
+	long clock;
+	int moves;
+	float moveScore;
+	int ant;
+	int step;
+	vector<float> terminals;
+};
+
+// A program's run (incremental evaluation mode), kept with it by the GP:
+// every sand move it made and a snapshot every snapshotEvery steps. Its
+// offspring run the same until they reach the code they were given, so
+// they start from the last snapshot before then.
+struct DesertRun
+{
+	vector<int> cells;
+	vector<char> colours;
+	vector<DesertSnapshot> snapshots;
+};
+
+static int snapshotEvery = DESERT_SNAPSHOTS;
+static DesertRun* recording = NULL;
+
 // ---------------------------------------------------------------------
 // Fitness Functions/Problem specific functions
 // ---------------------------------------------------------------------
@@ -36,93 +120,443 @@ static bool collectData = 0;
 // Postcondition: GP will stop generating once a program has a hit
 int desertTermination(GP* g)
 {
-	if(g->bestofgen_hits > 0)
+	// Only the best of run has been scored with every ant when sampling
+	int hits = g->full_fitness_function ? g->best_of_run.hits : g->bestofgen_hits;
+
+	if(hits > 0)
 		return 1;
 	else
 		return 0;
 }
 
+// Generation Callback
+// Precondition: GP setup and sampling the ants
+// Postcondition: Next ants chosen, every program is scored with them
+// next generation (so all the fitnesses compared come from the same ants)
+int desertGeneration(GP* g)
+{
+	antCases.sample();
+
+	for(int i = 0; i < g->M; i += 1)
+		g->pop[i].recalc_needed = 1;
+
+	return 0;
+}
+
+// Sand Penalty
+// Precondition: n/a
+// Postcondition: Returns how far a grain of colour in column x is from
+// its place (colour 1 belongs in column 0, 2 in 1 and 3 in 2)
+static float sandPenalty(int x, int colour)
+{
+	switch(colour)
+	{
+	case 1:
+		if(x != 0)
+			return x;
+
+		break;
+
+	case 2:
+		if(x == 0)
+			return 1;
+		else if(x != 1)
+			return x;
+
+		break;
+
+	case 3:
+		if(x == 0)
+			return 2;
+		else if(x == 1)
+			return 1;
+		else if(x != 2)
+			return x;
+
+		break;
+	}
+
+	return 0;
+}
+
 // Init map
 // Precondition: startMap setup
-// Postcondition: map is reset
+// Postcondition: map is reset, the scores with it
 void initialiseMap()
 {
-	for(int i = 0; i < 20; i += 1)
+	if(!mapCopied)
 	{
-		for(int j = 0; j < 10; j += 1)
+		map = startMap;
+		mapCopied = 1;
+
+		// Nested loop checks positions of sand (only when startMap is new,
+		// moveSand keeps the score after that)
+		startScore = 0;
+
+		for(int i = 0; i < map.getDepth(); i += 1)
+			for(int j = 0; j < map.getWidth(); j += 1)
+				startScore += sandPenalty(j, map.getSand(j, i));
+	}
+	else
+	{
+		// Put back only the cells the ants changed
+		int width = map.getWidth();
+
+		for(unsigned int i = 0; i < changed.size(); i += 1)
 		{
-			map[j][i] = startMap[j][i];
+			int x = changed[i] % width;
+			int z = changed[i] / width;
+
+			map.setSand(x, z, startMap.getSand(x, z));
 		}
 	}
+
+	changed.clear();
+	changedColour.clear();
+
+	sandScore = startScore;
+	moveScore = 0;
 }
 
-// Fitness function for ant problem
-// Precondition: GP setup and this function added as fitness function
-// Postcondition: Fitness tested
-float antFitness(S_Expression* s, int* hits)
+// Move Sand
+// Precondition: x/z on the map
+// Postcondition: Sand at x/z set and scored, the change is undone by
+// initialiseMap
+static void moveSand(int x, int z, int colour)
 {
-	// Reset Map
-	initialiseMap();
+	sandScore += sandPenalty(x, colour) - sandPenalty(x, map.getSand(x, z));
+
+	map.setSand(x, z, colour);
+	changed.push_back(z * map.getWidth() + x);
+	changedColour.push_back(colour);
+	mapVersion += 1;
+}
+
+// Uses function
+// Precondition: n/a
+// Postcondition: Returns true if the function is anywhere in the tree
+bool usesFunction(S_Expression* s, int function)
+{
+	if(s->type != STfunction)
+		return 0;
+
+	if(s->which == function)
+		return 1;
+
+	for(int i = 0; i < Fset.nargs(s->which); i += 1)
+		if(usesFunction(s->args[i], function))
+			return 1;
 
-	// Setup fitness variable
-	float fitness = 0;
+	return 0;
+}
+
+// Add Snapshot
+// Precondition: Recording a run, about to run step of the ant'th ant
+// Postcondition: Returns a new snapshot with everything but the
+// terminals filled in
+static DesertSnapshot& addSnapshot(int ant, int step)
+{
+	recording->snapshots.push_back(DesertSnapshot());
+
+	DesertSnapshot& snapshot = recording->snapshots.back();
+	snapshot.clock = S_Expression::clock;
+	snapshot.moves = changed.size();
+	snapshot.moveScore = moveScore;
+	snapshot.ant = ant;
+	snapshot.step = step;
+
+	return snapshot;
+}
+
+// Find Snapshot
+// Precondition: n/a
+// Postcondition: Returns the last snapshot taken at or before clock (NULL
+// if none was)
+static const DesertSnapshot* findSnapshot(const DesertRun* run, long clock)
+{
+	for(int i = (int)run->snapshots.size() - 1; i >= 0; i -= 1)
+		if(run->snapshots[i].clock <= clock)
+			return &run->snapshots[i];
+
+	return NULL;
+}
+
+// Run Ants In Turn
+// Precondition: map reset (or as it was at from)
+// Postcondition: Each ant run steps times before the next starts (from
+// the snapshot if there is one), the fitness of their moves added to
+// moveScore
+static void runInTurn(S_Expression* s, bool every, const DesertSnapshot* from)
+{
+	// GO-Rand makes a program random, its runs need not repeat
+	bool deterministic = detectCycles && !usesFunction(s, Fset.index("GO-Rand"));
 
-	for(int i = 0; i < 20; i += 1)
+	// Nothing is carried over from the last program
+	if(!from)
 	{
-		// Set x and y to ant positions
-		Tset.modify("X", antPos[i].x);
-		Tset.modify("Y", antPos[i].z);
+		Tset.modify("CARRYING", -1);
+		Tset.modify("COLOUR", -1);
+	}
+
+	// Fitness and ant state before each run (for cycle detection)
+	static vector<float> before;
+	static vector<float> state;
 
-		// Loop to run program - 300 moves
-		for(int j = 0; j < 300; j += 1)
+	before.resize(steps);
+	state.resize(steps * 4);
+
+	int ants = every ? antCases.getCount() : antCases.getActive();
+
+	for(int k = from ? from->ant : 0; k < ants; k += 1)
+	{
+		int i = every ? k : antCases.getActiveCase(k);
+		int start = 0;
+
+		if(from && k == from->ant)
+		{
+			// Carry on where the snapshot was taken
+			Tset.modify("X", from->terminals[0]);
+			Tset.modify("Y", from->terminals[1]);
+			Tset.modify("CARRYING", from->terminals[2]);
+			Tset.modify("COLOUR", from->terminals[3]);
+
+			start = from->step;
+		}
+		else
 		{
+			// Set x and y to ant positions
+			Tset.modify("X", antPos[i].x);
+			Tset.modify("Y", antPos[i].z);
+		}
+
+		unsigned int version = mapVersion;
+		cycles->begin();
+
+		// Loop to run program
+		for(int j = start; j < steps; j += 1)
+		{
+			S_Expression::clock = (long)k * steps + j;
+
+			if(recording && j % snapshotEvery == 0)
+			{
+				vector<float>& terminals = addSnapshot(k, j).terminals;
+
+				terminals.push_back(Tset.get("X"));
+				terminals.push_back(Tset.get("Y"));
+				terminals.push_back(Tset.get("CARRYING"));
+				terminals.push_back(Tset.get("COLOUR"));
+			}
+
+			// The program sees X, Y, CARRYING, COLOUR and the map. Once
+			// all of them repeat, every run after repeats too, so add
+			// the remaining runs' fitness in closed form instead.
+			if(deterministic)
+			{
+				// Sand moved, earlier states can't come round again
+				if(mapVersion != version)
+				{
+					version = mapVersion;
+					cycles->begin();
+				}
+
+				float X = Tset.get("X");
+				float Y = Tset.get("Y");
+				float carrying = Tset.get("CARRYING");
+				float colour = Tset.get("COLOUR");
+
+				unsigned long long key = ((unsigned long long)(int)X << 48) | ((unsigned long long)(int)Y << 32)
+					| ((unsigned long long)(int)(carrying + 1) << 16) | (unsigned long long)(int)(colour + 1);
+
+				int first = cycles->visit(key, j);
+
+				if(first >= 0)
+				{
+					int period = j - first;
+					int remaining = steps - j;
+					int end = first + remaining % period;
+
+					moveScore += (remaining / period) * (moveScore - before[first]);
+					moveScore += before[end] - before[first];
+
+					Tset.modify("X", state[end * 4 + 0]);
+					Tset.modify("Y", state[end * 4 + 1]);
+					Tset.modify("CARRYING", state[end * 4 + 2]);
+					Tset.modify("COLOUR", state[end * 4 + 3]);
+					break;
+				}
+
+				before[j] = moveScore;
+				state[j * 4 + 0] = X;
+				state[j * 4 + 1] = Y;
+				state[j * 4 + 2] = carrying;
+				state[j * 4 + 3] = colour;
+			}
+
 			// Run the program
 			s->eval();
 
 			// Ant should have dropped sand
 			if(Tset.get("CARRYING") > 0)
 			{
-				fitness += 40;
+				moveScore += 40;
 
 				// Set carrying back to default
 				Tset.modify("CARRYING", -1);
 			}
 		}
 	}
+}
+
+// Run Ants Together
+// Precondition: map reset (or as it was at from)
+// Postcondition: Every ant run steps times, one step each per tick (from
+// the snapshot if there is one), the fitness of their moves added to
+// moveScore
+static void runTogether(S_Expression* s, bool every, const DesertSnapshot* from)
+{
+	int ants = every ? antCases.getCount() : antCases.getActive();
+
+	antX.resize(ants);
+	antY.resize(ants);
+	antCarrying.resize(ants);
+	antColour.resize(ants);
+	antIndex.resize(ants);
+
+	for(int k = 0; k < ants; k += 1)
+	{
+		int i = every ? k : antCases.getActiveCase(k);
+
+		antX[k] = antPos[i].x;
+		antY[k] = antPos[i].z;
+		antCarrying[k] = -1;
+		antColour[k] = -1;
+		antIndex[k] = i;
+	}
+
+	// Carry on where the snapshot was taken
+	if(from)
+	{
+		for(int k = 0; k < ants; k += 1)
+		{
+			antX[k] = from->terminals[k];
+			antY[k] = from->terminals[ants + k];
+			antCarrying[k] = from->terminals[ants * 2 + k];
+			antColour[k] = from->terminals[ants * 3 + k];
+		}
+	}
 
-	// Nested loop checks positions of sand
-	for(int i = 0; i < 20; i += 1)
+	// The terminals are swapped for each ant's own every step
+	int x = Tset.index("X");
+	int y = Tset.index("Y");
+	int carrying = Tset.index("CARRYING");
+	int colour = Tset.index("COLOUR");
+
+	for(int j = from ? from->step : 0; j < steps; j += 1)
 	{
-		for(int j = 0; j < 20; j += 1)
+		// A snapshot is taken before the tick's first ant runs
+		S_Expression::clock = (long)j * ants;
+
+		if(recording && j % snapshotEvery == 0)
 		{
-			switch(map[j][i])
-			{
-			case 1:
-				if(j != 0)
-					fitness += j;
+			vector<float>& terminals = addSnapshot(0, j).terminals;
 
-				break;
+			terminals.insert(terminals.end(), antX.begin(), antX.end());
+			terminals.insert(terminals.end(), antY.begin(), antY.end());
+			terminals.insert(terminals.end(), antCarrying.begin(), antCarrying.end());
+			terminals.insert(terminals.end(), antColour.begin(), antColour.end());
+		}
+
+		for(int k = 0; k < ants; k += 1)
+		{
+			S_Expression::clock = (long)j * ants + k;
 
-			case 2:
-				if(j == 0)
-					fitness += 1;
-				else if(j != 1)
-					fitness += j;
+			Tset.modify(x, antX[k]);
+			Tset.modify(y, antY[k]);
+			Tset.modify(carrying, antCarrying[k]);
+			Tset.modify(colour, antColour[k]);
 
-				break;
+			collectIndex = antIndex[k];
+			s->eval();
 
-			case 3:
-				if(j == 0)
-					fitness += 2;
-				else if(j == 1)
-					fitness += 1;
-				else if(j != 2)
-					fitness += j;
+			antX[k] = Tset.get(x);
+			antY[k] = Tset.get(y);
+			antCarrying[k] = Tset.get(carrying);
+			antColour[k] = Tset.get(colour);
 
-				break;
+			// Ant should have dropped sand
+			if(antCarrying[k] > 0)
+			{
+				moveScore += 40;
+				antCarrying[k] = -1;
 			}
 		}
 	}
+}
+
+// Run Ants
+// Precondition: GP setup
+// Postcondition: Fitness tested with the ants sampled this generation,
+// or every ant
+static float runAnts(S_Expression* s, int* hits, bool every)
+{
+	// Reset Map
+	initialiseMap();
+
+	// Incremental evaluation: start from the parent's last snapshot before
+	// this program can first differ from it, and save this run for its
+	// own offspring (a random program's runs are never the same twice)
+	DesertRun* run = NULL;
+	const DesertSnapshot* from = NULL;
+
+	if(evaluating && snapshotEvery > 0 && !usesFunction(s, Fset.index("GO-Rand")))
+	{
+		run = new DesertRun();
+
+		const DesertRun* parent = (const DesertRun*)evaluating->state.get();
+
+		if(parent)
+			from = findSnapshot(parent, evaluating->diverge);
+
+		if(from)
+		{
+			// Put the sand where the parent had moved it
+			int width = map.getWidth();
+
+			for(int i = 0; i < from->moves; i += 1)
+				moveSand(parent->cells[i] % width, parent->cells[i] / width, parent->colours[i]);
+
+			moveScore = from->moveScore;
+
+			// The earlier snapshots hold for this program too (from is
+			// taken again as the run starts)
+			run->snapshots.assign(parent->snapshots.begin(), parent->snapshots.begin() + (from - &parent->snapshots[0]));
+		}
+	}
+
+	recording = run;
+
+	// Move the ants
+	if(simultaneous)
+		runTogether(s, every, from);
+	else
+		runInTurn(s, every, from);
+
+	recording = NULL;
+
+	if(evaluating)
+	{
+		if(run)
+		{
+			run->cells = changed;
+			run->colours = changedColour;
+		}
+
+		// The parent's run is let go here, from isn't used after this
+		evaluating->state = shared_ptr<void>(run);
+	}
+
+	// The sand was scored as it moved
+	float fitness = moveScore + sandScore;
 
 	if(fitness == 0)
 		*hits += 1;
@@ -130,6 +564,31 @@ float antFitness(S_Expression* s, int* hits)
 	return fitness;
 }
 
+// Partial Fitness
+// Precondition: An evaluation has started
+// Postcondition: Returns its fitness so far (the moves made, and the sand
+// as it lies now), the final fitness once it's done
+float antPartialFitness()
+{
+	return moveScore + sandScore;
+}
+
+// Fitness function for ant problem
+// Precondition: GP setup and this function added as fitness function
+// Postcondition: Fitness tested
+float antFitness(S_Expression* s, int* hits)
+{
+	return runAnts(s, hits, 0);
+}
+
+// Full Fitness function for ant problem
+// Precondition: GP setup and sampling the ants
+// Postcondition: Fitness tested with every ant
+float antFullFitness(S_Expression* s, int* hits)
+{
+	return runAnts(s, hits, 1);
+}
+
 // Function Set
 
 // Update Colour
@@ -142,10 +601,10 @@ float checkColour()
 	int Y = (int)Tset.get("Y");
 
 	// If there is something at map positon
-	if(map[X][Y])
+	if(map.getSand(X, Y))
 	{
-		Tset.modify("COLOUR", map[X][Y]);
-		return map[X][Y];
+		Tset.modify("COLOUR", map.getSand(X, Y));
+		return map.getSand(X, Y);
 	}
 	else
 	{
@@ -169,7 +628,7 @@ float goNorth(S_Expression** params)
 
 	// Check if the ant moves off the grid
 	if(Y <= 0)
-		Tset.modify("Y", 19);
+		Tset.modify("Y", map.getDepth() - 1);
 	else
 		Tset.modify("Y", Y - 1);
 
@@ -189,7 +648,7 @@ float goEast(S_Expression** params)
 	int Y = (int)Tset.get("Y");
 
 	// Check if the ant moves off the grid
-	if(X >= 19)
+	if(X >= map.getWidth() - 1)
 		Tset.modify("X", 0);
 	else
 		Tset.modify("X", X + 1);
@@ -210,7 +669,7 @@ float goSouth(S_Expression** param)
 	int Y = (int)Tset.get("Y");
 
 	// Check if the ant moves off the grid
-	if(Y >= 19)
+	if(Y >= map.getDepth() - 1)
 		Tset.modify("Y", 0);
 	else
 		Tset.modify("Y", Y + 1);
@@ -232,7 +691,7 @@ float goWest(S_Expression** params)
 
 	// Check if the ant moves off the grid
 	if(X <= 0)
-		Tset.modify("X", 19);
+		Tset.modify("X", map.getWidth() - 1);
 	else
 		Tset.modify("X", X - 1);
 
@@ -279,16 +738,16 @@ float pickUp(S_Expression** params)
 
 	// Check if the ant is carrying sand
 	if(Tset.get("CARRYING") > 0)
-		return map[X][Y];
+		return map.getSand(X, Y);
 
 	// Check if there is something at the position
-	if(map[X][Y] > 0)
+	if(map.getSand(X, Y) > 0)
 	{
 		// Pick up the sand
-		Tset.modify("CARRYING", map[X][Y]);
+		Tset.modify("CARRYING", map.getSand(X, Y));
 
 		// Remove the sand from the map
-		map[X][Y] = 0;
+		moveSand(X, Y, 0);
 
 		// Return what's left, -1
 		return -1;
@@ -334,10 +793,10 @@ float ifDrop(S_Expression** params)
 	if(Tset.get("CARRYING") > 0)
 	{
 		// Check that the current x, y is empty
-		if(map[X][Y] == 0)
+		if(map.getSand(X, Y) == 0)
 		{
 			// Drops the sand on the map
-			map[X][Y] == Tset.get("CARRYING");
+			moveSand(X, Y, (int)Tset.get("CARRYING"));
 			Tset.modify("CARRYING", -1);
 
 			return params[0]->eval();
@@ -367,7 +826,7 @@ void PAIDesert::AIMoveNorth(int antIndex)
 
 	// Check if the ant moves off the grid
 	if(Y <= 0)
-		ant[antIndex].setPosition(X, 0, 19);
+		ant[antIndex].setPosition(X, 0, renderMap.getDepth() - 1);
 	else
 		ant[antIndex].setPosition(X, 0, Y - 1);
 }
@@ -379,7 +838,7 @@ void PAIDesert::AIMoveEast(int antIndex)
 	int Y = ant[antIndex].getPosition().z;
 
 	// Check if the ant moves off the grid
-	if(X >= 19)
+	if(X >= renderMap.getWidth() - 1)
 		ant[antIndex].setPosition(0, 0, Y);
 	else
 		ant[antIndex].setPosition(X + 1, 0.0, Y);
@@ -392,7 +851,7 @@ void PAIDesert::AIMoveSouth(int antIndex)
 	int Y = ant[antIndex].getPosition().z;
 
 	// Check if the ant moves off the grid
-	if(Y >= 19)
+	if(Y >= renderMap.getDepth() - 1)
 		ant[antIndex].setPosition(X, 0, 0);
 	else
 		ant[antIndex].setPosition(X, 0, Y + 1);
@@ -406,7 +865,7 @@ void PAIDesert::AIMoveWest(int antIndex)
 
 	// Check if the ant moves off the grid
 	if(X <= 0)
-		ant[antIndex].setPosition(19, 0, Y);
+		ant[antIndex].setPosition(renderMap.getWidth() - 1, 0, Y);
 	else
 		ant[antIndex].setPosition(X - 1, 0, Y);
 }
@@ -424,13 +883,13 @@ void PAIDesert::AIPickUp(int antIndex)
 		return;
 
 	// Check if there is something at the position
-	if(renderMap[X][Y])
+	if(renderMap.getSand(X, Y))
 	{
 		// Pick up the sand
-		ant[antIndex].carrying = renderMap[X][Y];
+		ant[antIndex].carrying = renderMap.getSand(X, Y);
 
 		// Remove the sand from the map
-		renderMap[X][Y] = 0;
+		renderMap.setSand(X, Y, 0);
 	}
 }
 
@@ -446,10 +905,10 @@ void PAIDesert::AIIfDrop(int antIndex)
 	if(ant[antIndex].carrying > 0)
 	{
 		// Check that the current x, y is empty
-		if(renderMap[X][Y] == 0)
+		if(renderMap.getSand(X, Y) == 0)
 		{
 			// Drops the sand on the map
-			renderMap[X][Y] = ant[antIndex].carrying;
+			renderMap.setSand(X, Y, ant[antIndex].carrying);
 			ant[antIndex].carrying = 0;
 		}
 	}
@@ -470,47 +929,35 @@ void PAIDesert::setupObjects()
 	grey.setTexture(L"Resources\\Textures\\grey.png");
 	white.setTexture(L"Resources\\Textures\\white.png");
 
-	for(int i = 0; i < 20; i += 1)
-	{
-		// int for whether positions are set
-		int set = 0;
+	startMap.resize(width, depth);
+	mapCopied = 0;
 
-		// Initialise ant
-		ant[i].Initialise();
+	// grains of each colour, then the ants (the seed is output so the
+	// desert can be made again)
+	if(sandSeed == 0)
+		sandSeed = (((unsigned int)rand() << 15) ^ rand()) | 1;
 
-		// Set random initial positions
-		ant[i].setPosition(GUVector4((int)(rand() % 20), 0.0, (int)(rand() % 20)));
-		antPos[i] = ant[i].getPosition();
+	PMapGenerator generator(sandSeed);
+	generator.scatterSand(startMap, grains, 3);
 
-		while(set < 3)
-		{
-			// Generate random Vector
-			GUVector4 randVec = GUVector4( (int)(rand() % 20), 0.0, (int)(rand() % 20));
+	ant.resize(antCount);
+	antPos.resize(antCount);
+	actions.resize(antCount);
 
-			// Check if it has already been taken
-			if(startMap[(int)(randVec.x)][(int)randVec.z] == 0)
-			{
-				// Assign if it's not taken
-				switch(set)
-				{
-				case 0:
-					startMap[(int)(randVec.x)][(int)randVec.z] = 1;
-					set += 1;
-					break;
+	for(int i = 0; i < antCount; i += 1)
+	{
+		// Initialise ant
+		ant[i].Initialise();
 
-				case 1:
-					startMap[(int)(randVec.x)][(int)randVec.z] = 2;
-					set += 1;
-					break;
+		// Set initial positions
+		int x = generator.next() % width;
+		int z = generator.next() % depth;
 
-				case 2:
-					startMap[(int)(randVec.x)][(int)randVec.z] = 3;
-					set += 1;
-					break;
-				}
-			}
-		}
+		ant[i].setPosition(GUVector4(x, 0.0, z));
+		antPos[i] = ant[i].getPosition();
 	}
+
+	cout << "Desert sand seed " << sandSeed << endl;
 }
 
 // Run best individual
@@ -520,7 +967,20 @@ void PAIDesert::runBestIndividual()
 {
 	collectData = 1;
 
-	for(collectIndex = 0; collectIndex < 20; collectIndex += 1)
+	// Ants moving together see each other's sand, so run them together
+	if(simultaneous)
+	{
+		for(collectIndex = 0; collectIndex < antCount; collectIndex += 1)
+			actions[collectIndex].clear();
+
+		initialiseMap();
+		runTogether(best.s, 1, NULL);
+
+		collectData = 0;
+		return;
+	}
+
+	for(collectIndex = 0; collectIndex < antCount; collectIndex += 1)
 	{
 		actions[collectIndex].clear();
 
@@ -528,8 +988,8 @@ void PAIDesert::runBestIndividual()
 		Tset.modify("X", antPos[collectIndex].x);
 		Tset.modify("Y", antPos[collectIndex].z);
 
-		// Loop to run program - 50 moves
-		for(int i = 0; i < 300; i += 1)
+		// Loop to run program
+		for(int i = 0; i < steps; i += 1)
 		{
 			best.s->eval();
 		}
@@ -543,13 +1003,7 @@ void PAIDesert::runBestIndividual()
 // Postcondition: rendermap is reset
 void PAIDesert::initialiseRendermap()
 {
-	for(int i = 0; i < 20; i += 1)
-	{
-		for(int j = 0; j < 20; j += 1)
-		{
-			renderMap[j][i] = startMap[j][i];
-		}
-	}
+	renderMap = startMap;
 }
 
 // ---------------------------------------------------------------------
@@ -565,12 +1019,24 @@ PAIDesert::PAIDesert()
 	move = 0;
 
 	gp = NULL;
+	sandSeed = 0;
+	antSample = DESERT_ANT_SAMPLE;
+	antsTogether = 0;
+	snapshots = DESERT_SNAPSHOTS;
+
+	// The desert is sized and every grain placed in setupObjects
+	width = DESERT_WIDTH;
+	depth = DESERT_DEPTH;
+	antCount = DESERT_ANTS;
+	grains = DESERT_GRAINS;
+	antSteps = DESERT_STEPS;
 }
 
 // Deconstructor
 PAIDesert::~PAIDesert()
 {
-	// EMPTY
+	delete cycles;
+	cycles = NULL;
 }
 
 // Initialise
@@ -600,12 +1066,24 @@ void PAIDesert::initialise()
 	myFSet.add("GO-Rand", 0, *goRandom, NULL, 1);
 	myFSet.add("PICK-UP", 0, *pickUp, NULL, 1);
 
-	myFSet.add("IFLTE", 4, *iflte, NULL);
-	myFSet.add("IFLTZ", 3, *ifltz, NULL);
-	myFSet.add("IF-DROP", 2, *ifDrop, NULL);
+	// The branches of the conditionals are passed through (bits),
+	// IF-DROP changes the map so it has side effects
+	myFSet.add("IFLTE", 4, *iflte, *edit_iflte, 0, 12);
+	myFSet.add("IFLTZ", 3, *ifltz, *edit_ifltz, 0, 6);
+	myFSet.add("IF-DROP", 2, *ifDrop, NULL, 1, 3);
 
 	// 3. Precalculate your set of fitness test cases
-	// NONE
+	// Each ant is one
+	antCases.setup(NULL, antCount, 1);
+	antCases.setSampleSize(antSample);
+
+	simultaneous = antsTogether;
+	steps = antSteps;
+	snapshotEvery = snapshots;
+
+	// A repeat can be up to a whole run apart
+	delete cycles;
+	cycles = new PCycleDetector(steps);
 
 	// 4. Declare the GP object
 	if(!gp)
@@ -614,6 +1092,29 @@ void PAIDesert::initialise()
 	// 5. Specify any non-default GP parameters
 	gp->verbose = DEBUG | END_REPORT;
 	gp->termination_criteria = *desertTermination;
+
+	// Simplify the population every 5 generations,
+	// the value returned by a program is never used
+	gp->fed = 5;
+	gp->discard_result = 1;
+	gp->egraph_usage = EGRAPH_BEST_OF_GEN;
+
+	// Vary only code that ran (GO-Rand makes the problem
+	// random, so unexecuted code is not pruned)
+	gp->use_coverage = 1;
+
+	// Offspring carry on from their parent's snapshots (the same ants
+	// have to be run every generation)
+	if(snapshotEvery > 0 && antCases.getActive() == antCases.getCount())
+		gp->incremental = 1;
+
+	// Different ants each generation, the best is run with every ant
+	// before it's reported
+	if(antCases.getActive() < antCases.getCount())
+	{
+		gp->generation_callback = *desertGeneration;
+		gp->full_fitness_function = *antFullFitness;
+	}
 }
 
 // Run GP and get best individual so far
@@ -627,7 +1128,7 @@ void PAIDesert::run()
 	current = 0;
 
 	// Set ants to default positions and variables
-	for(int i = 0; i < 20; i += 1)
+	for(int i = 0; i < antCount; i += 1)
 	{
 		ant[i].carrying = 0;
 		ant[i].setPosition(antPos[i]);
@@ -657,6 +1158,15 @@ void PAIDesert::refreshPop()
 	run();
 }
 
+// Benchmark
+// Precondition: GP setup and a population has been evaluated
+// Postcondition: Node-count and evaluation time savings output
+void PAIDesert::benchmark()
+{
+	if(gp && gp->gen > 0)
+		egraph_benchmark(gp);
+}
+
 // Update
 // Precondition: n/a
 // Postcondition: All ants and objects updated
@@ -673,7 +1183,7 @@ void PAIDesert::update(float delta)
 			current += 1;
 
 			// Move everything to the next place
-			for(int i = 0; i < 20; i += 1)
+			for(int i = 0; i < antCount; i += 1)
 			{
 				if(current < actions[i].size())
 				{
@@ -715,23 +1225,24 @@ void PAIDesert::update(float delta)
 void PAIDesert::render(const CoreStructures::GUMatrix4& T)
 {
 	// Render each of the boxes
-	for(int i = 0; i < 20; i += 1)
-	{
+	for(int i = 0; i < antCount; i += 1)
 		ant[i].Render(T);
 
-		for(int j = 0; j < 20; j += 1)
+	for(int i = 0; i < renderMap.getDepth(); i += 1)
+	{
+		for(int j = 0; j < renderMap.getWidth(); j += 1)
 		{
-			if(renderMap[j][i] == 1)
+			if(renderMap.getSand(j, i) == 1)
 			{
 				black.setPosition(j, 0.0, i);
 				black.Render(T);
 			}
-			else if(renderMap[j][i] == 2)
+			else if(renderMap.getSand(j, i) == 2)
 			{
 				grey.setPosition(j, 0.0, i);
 				grey.Render(T);
 			}
-			else if(renderMap[j][i] == 3)
+			else if(renderMap.getSand(j, i) == 3)
 			{
 				white.setPosition(j, 0.0, i);
 				white.Render(T);
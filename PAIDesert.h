@@ -36,11 +36,31 @@ private:
 	Individual best;
 
 	// AI Objects - Ants, Sand
-	PAIAnt ant[20];
+	std::vector<PAIAnt> ant;
 	PBox black;
 	PBox grey;
 	PBox white;
 
+	// Seed the sand and ants are placed from (0 == pick one at random)
+	unsigned int sandSeed;
+
+	// Desert size, number of ants, grains of each colour and program
+	// runs per ant
+	int width;
+	int depth;
+	int antCount;
+	int grains;
+	int antSteps;
+
+	// Ants run each generation (0 == all of them)
+	int antSample;
+
+	// Ants take their steps together rather than one ant at a time
+	bool antsTogether;
+
+	// Steps between snapshots of a program's run (0 == none taken)
+	int snapshots;
+
 	// Problem Specific Terminal and Function sets
 	FunctionSet myFSet;
 	TerminalSet myTSet;
@@ -80,12 +100,40 @@ public:
 	// Create new population
 	void refreshPop();
 
+	// Report what simplification does to the population
+	void benchmark();
+
 	// Update and render
 	void update(float delta);
 	void render(const CoreStructures::GUMatrix4& T);
 
 	// Set not in use
 	void setInUse();
+
+	// Place the sand and ants from this seed (call before initialise)
+	void setSandSeed(unsigned int seed) { sandSeed = seed; }
+
+	// Score each generation with n of the ants, taking them in turn
+	// (call before initialise, 0 == all of them)
+	void setAntSample(int n) { antSample = n; }
+
+	// Move every ant one step per tick on the shared map, rather than
+	// each ant all the way through in turn (call before initialise)
+	void setAntsTogether(bool together) { antsTogether = together; }
+
+	// Size of the problem (call before initialise): a width by depth
+	// desert with ants ants, grains grains of each of the three colours,
+	// and each ant's program run steps times
+	void setDesertSize(int width, int depth) { this->width = width; this->depth = depth; }
+	void setAntCount(int ants) { antCount = ants; }
+	void setGrains(int grains) { this->grains = grains; }
+	void setSteps(int steps) { antSteps = steps; }
+
+	// Snapshot each program's run every steps steps, so its offspring
+	// can carry on from the last one before they first run the code
+	// they changed, rather than running every step again (call before
+	// initialise, 0 == off, only used when every ant is run)
+	void setSnapshots(int steps) { snapshots = steps; }
 };
 
 #endif
\ No newline at end of file
@@ -7,26 +7,123 @@
 
 // Other includes
 #include "random.h"
+#include "PCycleDetector.h"
+#include "PGrid.h"
+#include "PFlowField.h"
+#include "PMapGenerator.h"
+#include "PFitnessCases.h"
+
+// Map file used in place of a generated map if it exists (its goal must
+// be 0, 0)
+#define PATH_MAP_FILE "Resources\\Maps\\path.pmap"
+
+// Walls in a generated map
+#define PATH_WALL_PERCENT 20
+
+// Size of a generated map (can be changed before initialise, a map file
+// has its own), the default start is the corner opposite the goal
+#define PATH_WIDTH WORLD_SIZE
+#define PATH_DEPTH WORLD_SIZE
+
+// Fitness cases: how many, whether each case after the first has its
+// own map (or only its own start on the shown map), how their scores are
+// combined and how many are sampled each generation (0 == all)
+#define PATH_CASES 1
+#define PATH_CASE_MAPS 1
+#define PATH_CASE_REDUCER PFitnessCases::REDUCE_SUM
+#define PATH_CASE_SAMPLE 0
 
 // Namespace
 using namespace std;
 using namespace CoreStructures;
 
 // Static variables (for fitness evaluation)
-static float fitness;
-static int map[20][20];
+static PGrid map;
+
+// A map and start to run the programs from (the goal is always 0, 0)
+struct PathCase
+{
+	PGrid map;
+	int startX;
+	int startY;
+
+	// Shortest path distance from every cell to the goal, built once
+	// the walls are placed
+	PFlowField goalField;
+
+	// Repeated positions between runs (cycle detection mode)
+	PCycleDetector cycles;
+
+	PathCase() : cycles(64) {}
+};
+
+// Fitness cases, the first is the shown map
+static PathCase* pathCases = NULL;
+static PFitnessCases caseRunner;
+
+// Case and fitness of the program running on this thread (cases are
+// run on several threads at once)
+static GP_THREAD_LOCAL PathCase* pathCase = NULL;
+static GP_THREAD_LOCAL float fitness;
+
+// Start position (the goal is 0, 0)
+static int startX = PATH_WIDTH - 1;
+static int startY = PATH_DEPTH - 1;
 
 // These are for data collection
 static bool collectData = 0;
 static vector<GUVector4> path;
 
+// Skip repeated runs once the position repeats (cycle detection mode)
+static bool detectCycles = 1;
+
 // Map checker for path finding
 bool checkPosition(int x, int z)
 {
-	if((x < 20 && z < 20) && (x >= 0 && z >= 0))
-		return map[x][z];
-	else
-		return 1;
+	return map.isBlocked(x, z);
+}
+
+// Goal distance
+// Precondition: pathCase set, x/y on its map
+// Postcondition: Moves to the goal around the walls (cells that can't
+// reach it score worse than any that can)
+static inline int goalDistance(int x, int y)
+{
+	int distance = pathCase->goalField.getDistance(x, y);
+
+	if(distance == PFlowField::UNREACHABLE)
+		return pathCase->map.getWidth() * pathCase->map.getDepth();
+
+	return distance;
+}
+
+// Choose Start
+// Precondition: c's map and goal field built
+// Postcondition: c starts on a random cell that can reach the goal
+// (the shown map's start if none is found)
+static void chooseStart(PathCase& c, PMapGenerator& generator)
+{
+	int width = c.map.getWidth();
+	int depth = c.map.getDepth();
+
+	for(int attempt = 0; attempt < 1000; attempt += 1)
+	{
+		int x = generator.next() % width;
+		int z = generator.next() % depth;
+
+		// Not the goal (0) or cut off from it
+		if(c.goalField.getDistance(x, z) > 0)
+		{
+			c.startX = x;
+			c.startY = z;
+			return;
+		}
+	}
+
+	c.startX = pathCases[0].startX;
+	c.startY = pathCases[0].startY;
+	c.map.setWall(c.startX, c.startY, 0);
+	c.goalField.update(c.map, 0, 0);
 }
 
 // ---------------------------------------------------------------------
@@ -35,49 +132,125 @@ bool checkPosition(int x, int z)
 
 // Termination Criteria
 // Precondition: GP setup/this function set as termination criteria
-// Postcondition: GP will stop generating once a program has a hit
+// Postcondition: GP will stop generating once a program has a hit on
+// every case
 int pathTermination(GP* g)
 {
-	if(g->bestofgen_hits > 0)
+	// Only the best of run has been scored on every case when sampling
+	int hits = g->full_fitness_function ? g->best_of_run.hits : g->bestofgen_hits;
+
+	if(hits >= caseRunner.getCount())
 		return 1;
 	else
 		return 0;
 }
 
-// Fitness function
-// Precondition: GP setup and this function added as fitness function
-// Postcondition: Fitness tested
-float pathFitness(S_Expression* s, int* hits)
+// Generation Callback
+// Precondition: GP setup and sampling the cases
+// Postcondition: New sample chosen, every program is scored on it next
+// generation (so all the fitnesses compared come from the same cases)
+int pathGeneration(GP* g)
 {
+	caseRunner.sample();
+
+	for(int i = 0; i < g->M; i += 1)
+		g->pop[i].recalc_needed = 1;
+
+	return 0;
+}
+
+// Case Fitness function
+// Precondition: Cases built
+// Postcondition: Fitness of s on case c
+float pathCaseFitness(S_Expression* s, int c, int* hits)
+{
+	pathCase = &pathCases[c];
+
 	// Fitness value
 	fitness = 0;
 
 	// 1. Set x, y to start position
-	Tset.modify("X", 19.0);
-	Tset.modify("Y", 19.0);
+	Tset.modify("X", pathCase->startX);
+	Tset.modify("Y", pathCase->startY);
+
+	// Fitness and position before each run (for cycle detection)
+	float before[50];
+	int startX[50], startY[50];
+
+	if(detectCycles)
+		pathCase->cycles.begin();
 
 	// 2. Run 50 moves
 	for(int i = 0; i < 50; i += 1)
 	{
+		int X = (int)Tset.get("X");
+		int Y = (int)Tset.get("Y");
+
+		// A program only sees X and Y, so once a position repeats
+		// every run after it repeats too. Add the remaining runs'
+		// fitness in closed form rather than running them.
+		if(detectCycles)
+		{
+			int first = pathCase->cycles.visit(((unsigned long long)X << 32) | Y, i);
+
+			if(first >= 0)
+			{
+				int period = i - first;
+				int remaining = 50 - i;
+				int end = first + remaining % period;
+
+				fitness += (remaining / period) * (fitness - before[first]);
+				fitness += before[end] - before[first];
+
+				Tset.modify("X", startX[end]);
+				Tset.modify("Y", startY[end]);
+				break;
+			}
+
+			before[i] = fitness;
+			startX[i] = X;
+			startY[i] = Y;
+		}
+
 		s->eval();
-		fitness += (Tset.get("X") + Tset.get("Y"));
+		fitness += goalDistance((int)Tset.get("X"), (int)Tset.get("Y"));
 	}
 
 	// 3. Calculate fitness of final position
 	// Goal location is 0, 0
-	// This will be the Manhatten distance from the goal
-	float pos = (Tset.get("X") + Tset.get("Y"));
+	// This will be the path distance from the goal
+	float pos = goalDistance((int)Tset.get("X"), (int)Tset.get("Y"));
 
 	// 4. Update hits, is the evaluated fitness acceptable?
+	int hit = 0;
+
 	if(pos == 0)
-		*hits += 1;
+		hit = 1;
 	else
 		fitness *= 2;
 
+	*hits += hit;
+
 	// 5. Return the fitness value
 	return fitness;
 }
 
+// Fitness function
+// Precondition: GP setup and this function added as fitness function
+// Postcondition: Fitness tested on every active case
+float pathFitness(S_Expression* s, int* hits)
+{
+	return caseRunner.evaluate(s, hits);
+}
+
+// Full Fitness function
+// Precondition: GP setup and sampling the cases
+// Postcondition: Fitness tested on every case
+float pathFullFitness(S_Expression* s, int* hits)
+{
+	return caseRunner.evaluateAll(s, hits);
+}
+
 // ---------------------------------------------------------------------
 // Function Set
 
@@ -98,7 +271,7 @@ float moveNorth(S_Expression** params)
 		return -1;
 	}
 	// If the map space is clear
-	else if(!map[X][Y - 1])
+	else if(!pathCase->map.isWall(X, Y - 1))
 	{
 		// Make the move
 		Tset.modify("Y", Y - 1);
@@ -107,7 +280,7 @@ float moveNorth(S_Expression** params)
 		if(collectData)
 			path.push_back(GUVector4(X, 0.0, Y - 1));
 		else
-			fitness += (X + Y) - 1;
+			fitness += goalDistance(X, Y - 1);
 
 		// Move Success
 		return 1;
@@ -131,13 +304,13 @@ float moveEast(S_Expression** params)
 
 	// Check if the ant moves off the grid
 	// Or is about to hit into a wall
-	if(X == 19)
+	if(X == pathCase->map.getWidth() - 1)
 	{
 		// Move failed
 		return -1;
 	}
 	// If the map space is clear
-	else if(!map[X + 1][Y])
+	else if(!pathCase->map.isWall(X + 1, Y))
 	{
 		// Make the move
 		Tset.modify("X", X + 1);
@@ -146,7 +319,7 @@ float moveEast(S_Expression** params)
 		if(collectData)
 			path.push_back(GUVector4(X + 1, 0.0, Y));
 		else
-			fitness += (X + Y) + 1;
+			fitness += goalDistance(X + 1, Y);
 
 		// Move Success
 		return 1;
@@ -170,13 +343,13 @@ float moveSouth(S_Expression** params)
 
 	// Check if the ant moves off the grid
 	// Or is about to hit into a wall
-	if(Y == 19)
+	if(Y == pathCase->map.getDepth() - 1)
 	{
 		// Move failed
 		return -1;
 	}
 	// If the map space is clear
-	else if(!map[X][Y + 1])
+	else if(!pathCase->map.isWall(X, Y + 1))
 	{
 		// Make the move
 		Tset.modify("Y", Y + 1);
@@ -185,7 +358,7 @@ float moveSouth(S_Expression** params)
 		if(collectData)
 			path.push_back(GUVector4(X, 0.0, Y + 1));
 		else
-			fitness += (X + Y) + 1;
+			fitness += goalDistance(X, Y + 1);
 
 		// Move Success
 		return 1;
@@ -215,7 +388,7 @@ float moveWest(S_Expression** params)
 		return -1;
 	}
 	// If the map space is clear
-	else if(!map[X - 1][Y])
+	else if(!pathCase->map.isWall(X - 1, Y))
 	{
 		// Make the move
 		Tset.modify("X", X - 1);
@@ -224,7 +397,7 @@ float moveWest(S_Expression** params)
 		if(collectData)
 			path.push_back(GUVector4(X - 1, 0.0, Y));
 		else
-			fitness += (X + Y) - 1;
+			fitness += goalDistance(X - 1, Y);
 
 		// Move Success
 		return 1;
@@ -267,12 +440,13 @@ float IFLTZ(S_Expression** params)
 // Postcondition: Data in the form of a vector of float4s
 void PAIPath::runBestProgram()
 {
-	// Collect path data
+	// Collect path data (on the shown map)
 	collectData = 1;
+	pathCase = &pathCases[0];
 
 	// Set position to default
-	Tset.modify("X", 19.0);
-	Tset.modify("Y", 19.0);
+	Tset.modify("X", startX);
+	Tset.modify("Y", startY);
 	
 	// Check for first run,
 	// It is impossible to score 0
@@ -289,7 +463,7 @@ void PAIPath::runBestProgram()
 		best = gp->best_of_run;
 
 	// Add initial position
-	path.push_back(GUVector4(19.0, 0.0, 19.0));
+	path.push_back(GUVector4(startX, 0.0, startY));
 
 	for(int i = 0; i < 50; i += 1)
 		best.s->eval();
@@ -348,32 +522,98 @@ void PAIPath::addASTile()
 // Postcondition: All objects setup/positions set
 void PAIPath::setupObjects()
 {
+	// Use the map file if there is one
+	if(mapFile.open(PATH_MAP_FILE) && mapFile.getGoalX() == 0 && mapFile.getGoalZ() == 0)
+	{
+		mapFile.load(map);
+		startX = mapFile.getStartX();
+		startY = mapFile.getStartZ();
+	}
+	else
+	{
+		mapFile.close();
+
+		// Randomise wall postions (the seed is output so the map can be
+		// made again)
+		if(mapSeed == 0)
+			mapSeed = (((unsigned int)rand() << 15) ^ rand()) | 1;
+
+		PMapGenerator generator(mapSeed);
+		generator.randomFill(map, width, depth, PATH_WALL_PERCENT);
+
+		startX = width - 1;
+		startY = depth - 1;
+
+		cout << "Path map seed " << mapSeed << endl;
+	}
+
+	// Keep the start and goal clear
+	map.setWall(startX, startY, 0);
+	map.setWall(0, 0, 0);
+
 	// Setup boxes
 	genetic.Initialise();
 	genetic.setTexture(L"Resources\\Textures\\ant.png");
-	genetic.setPosition(19.0, 0.0, 19.0);
+	genetic.setPosition(startX, 0.0, startY);
 
 	aStar.Initialise();
 	aStar.setTexture(L"Resources\\Textures\\astar.png");
-	aStar.setPosition(19.0, 0.0, 19.0);
+	aStar.setPosition(startX, 0.0, startY);
 
-	// Randomise wall postions
-	int set = 0;
+	wall.Initialise();
+	wall.setTexture(L"Resources\\Textures\\black.png");
 
-	while(set < 80)
+	wallCells.clear();
+
+	for(int z = 0; z < map.getDepth(); z += 1)
+		for(int x = 0; x < map.getWidth(); x += 1)
+			if(map.isWall(x, z))
+				wallCells.push_back(z * map.getWidth() + x);
+}
+
+// Setup Cases
+// Precondition: Objects setup
+// Postcondition: Fitness cases built, the first is the shown map
+void PAIPath::setupCases()
+{
+	if(caseCount < 1)
+		caseCount = 1;
+
+	delete[] pathCases;
+	pathCases = new PathCase[caseCount];
+
+	pathCases[0].map = map;
+	pathCases[0].startX = startX;
+	pathCases[0].startY = startY;
+
+	// A map file's distance field saves searching the shown map again
+	if(mapFile.isOpen() && mapFile.hasDistance())
+		pathCases[0].goalField.load(map, 0, 0, mapFile.getDistances());
+	else
+		pathCases[0].goalField.update(map, 0, 0);
+
+	// The other cases come from seeds after the shown map's, so they
+	// can be made again too
+	for(int i = 1; i < caseCount; i += 1)
 	{
-		int randX = rand() % 20;
-		int randY = rand() % 20;
+		PathCase& c = pathCases[i];
+		PMapGenerator generator(mapSeed + i);
 
-		if(!map[randX][randY])
+		if(caseMaps)
 		{
-			map[randX][randY] = 1;
-			walls[set].Initialise();
-			walls[set].setTexture(L"Resources\\Textures\\black.png");
-			walls[set].setPosition(randX, 0.0, randY);
-			set += 1;
+			generator.randomFill(c.map, map.getWidth(), map.getDepth(), PATH_WALL_PERCENT);
+			c.map.setWall(0, 0, 0);
 		}
+		else
+			c.map = map;
+
+		c.goalField.update(c.map, 0, 0);
+		chooseStart(c, generator);
 	}
+
+	caseRunner.setup(*pathCaseFitness, caseCount);
+	caseRunner.setReducer(caseReducer);
+	caseRunner.setSampleSize(caseSample);
 }
 
 // ---------------------------------------------------------------------
@@ -387,11 +627,16 @@ PAIPath::PAIPath()
 	gp = NULL;
 	move = 0;
 	moveTime = 0;
+	mapSeed = 0;
 
-	// Initialise map
-	for(int i = 0; i < 20; i += 1)
-		for(int j = 0; j < 20; j += 1)
-				map[j][i] = 0;
+	caseCount = PATH_CASES;
+	caseMaps = PATH_CASE_MAPS;
+	caseReducer = PATH_CASE_REDUCER;
+	caseSample = PATH_CASE_SAMPLE;
+
+	// The map is sized and its walls placed in setupObjects
+	width = PATH_WIDTH;
+	depth = PATH_DEPTH;
 }
 
 // Deconstructor
@@ -400,6 +645,9 @@ PAIPath::~PAIPath()
 	// Clear lists
 	gpPath.clear();
 	asPath.clear();
+
+	delete[] pathCases;
+	pathCases = NULL;
 }
 
 // Initialise
@@ -411,14 +659,19 @@ void PAIPath::initialise()
 	setupObjects();
 
 	// Setup pathfinding
+	pf.setMapSize(map.getWidth(), map.getDepth());
 	pf.attachMapCheck(*checkPosition);
 
+	// The walls are fixed now, so the jump table can be built once
+	pf.setSearchMode(Pathfinding::SEARCH_JPS_PLUS);
+	pf.Preprocess();
+
 	// Find optimal path
 	pf.FindPath(aStar.getPosition(), GUVector4(0.0, 0.0, 0.0));
 
 	// 1. Specify terminal set
-	myTSet.add("X", 19.0);
-	myTSet.add("Y", 19.0);
+	myTSet.add("X", startX);
+	myTSet.add("Y", startY);
 
 	// 2. Specify function set
 	myFSet.add("MOVE-N", 0, *moveNorth, NULL, 1);
@@ -426,11 +679,12 @@ void PAIPath::initialise()
 	myFSet.add("MOVE-S", 0, *moveSouth, NULL, 1);
 	myFSet.add("MOVE-W", 0, *moveWest, NULL, 1);
 
-	myFSet.add("IFLTE", 4, *IFLTE, NULL);
-	myFSet.add("IFLTZ", 3, *IFLTZ, NULL);
+	// The branches of the conditionals are passed through (bits)
+	myFSet.add("IFLTE", 4, *IFLTE, *edit_iflte, 0, 12);
+	myFSet.add("IFLTZ", 3, *IFLTZ, *edit_ifltz, 0, 6);
 
 	// 3. Precalculate your set of fitness test cases
-	// N/A
+	setupCases();
 
 	// 4. Declare the GP object
 	if(!gp)
@@ -439,6 +693,27 @@ void PAIPath::initialise()
 	// 5. Specify any non-default GP parameters
 	gp->verbose = DEBUG | END_REPORT;
 	gp->termination_criteria = *pathTermination;
+
+	// Simplify the population every 5 generations,
+	// the value returned by a program is never used
+	gp->fed = 5;
+	gp->discard_result = 1;
+	gp->egraph_usage = EGRAPH_BEST_OF_GEN;
+
+	// The path problem is deterministic, so code that never ran
+	// during evaluation never will: vary and keep only live code
+	gp->use_coverage = 1;
+	gp->prune_introns = 1;
+
+	// A new sample of cases each generation, the best is scored on
+	// every case. Code that didn't run on this sample may run on the
+	// next, so it's kept.
+	if(caseRunner.getActive() < caseRunner.getCount())
+	{
+		gp->generation_callback = *pathGeneration;
+		gp->full_fitness_function = *pathFullFitness;
+		gp->prune_introns = 0;
+	}
 }
 
 // Run
@@ -448,8 +723,8 @@ void PAIPath::run()
 {
 	// Reset variables/Stop animation
 	move = 0;
-	genetic.setPosition(19.0, 0.0, 19.0); // Start position
-	aStar.setPosition(19.0, 0.0, 19.0);
+	genetic.setPosition(startX, 0.0, startY); // Start position
+	aStar.setPosition(startX, 0.0, startY);
 	current = 0; // Set current
 	path.clear(); // Empty vector
 	gpPath.clear(); // Empty vector
@@ -483,6 +758,15 @@ void PAIPath::refreshPop()
 	run();
 }
 
+// Benchmark
+// Precondition: GP setup and a population has been evaluated
+// Postcondition: Node-count and evaluation time savings output
+void PAIPath::benchmark()
+{
+	if(gp && gp->gen > 0)
+		egraph_benchmark(gp);
+}
+
 // Update
 // Precondition: n/a
 // Postcondition: All objects updated
@@ -529,8 +813,11 @@ void PAIPath::render(const CoreStructures::GUMatrix4& T)
 	genetic.Render(T);
 	aStar.Render(T);
 
-	for(int i = 0; i < 80; i += 1)
-		walls[i].Render(T);
+	for(unsigned int i = 0; i < wallCells.size(); i += 1)
+	{
+		wall.setPosition(wallCells[i] % map.getWidth(), 0.0, wallCells[i] / map.getWidth());
+		wall.Render(T);
+	}
 
 	// Draw path (GP)
 	for(list<PTile>::iterator tileIt = gpPath.begin(); tileIt != gpPath.end(); tileIt++)
@@ -7,8 +7,11 @@
 #include "PBox.h"
 #include "PTile.h"
 #include "Pathfinding.h"
+#include "PFitnessCases.h"
+#include "PMapLoader.h"
 
 #include <list>
+#include <vector>
 #include <CoreStructures\GUVector4.h>
 #include <CoreStructures\GUMatrix4.h>
 
@@ -48,8 +51,25 @@ private:
 	PBox genetic;
 	PBox aStar;
 
-	// Walls
-	PBox walls[80];
+	// Walls (one box, drawn at each wall cell)
+	PBox wall;
+	std::vector<int> wallCells;
+
+	// Map file (kept open so its distance field can seed the first case)
+	PMapLoader mapFile;
+
+	// Seed the map is generated from (0 == pick one at random)
+	unsigned int mapSeed;
+
+	// Size of a generated map
+	int width;
+	int depth;
+
+	// Fitness cases (maps or start positions) each program is scored on
+	int caseCount;
+	bool caseMaps;
+	PFitnessCases::Reducer caseReducer;
+	int caseSample;
 
 	// Problem Specific Terminal and Function sets
 	FunctionSet myFSet;
@@ -69,6 +89,9 @@ private:
 	// Setup Objects
 	void setupObjects();
 
+	// Build the fitness cases
+	void setupCases();
+
 // ---------------------------------------------------------------------
 public:
 
@@ -85,12 +108,33 @@ public:
 	// Create new population
 	void refreshPop();
 
+	// Report what simplification does to the population
+	void benchmark();
+
 	// Update/Render
 	void Update(float delta);
 	void render(const CoreStructures::GUMatrix4& T);
 
 	// Set in use
 	void setInUse();
+
+	// Generate the map from this seed (call before initialise)
+	void setMapSeed(unsigned int seed) { mapSeed = seed; }
+
+	// Size of a generated map (call before initialise), the program
+	// starts in the corner opposite the goal. A map file keeps its own
+	// size and start.
+	void setMapSize(int width, int depth) { this->width = width; this->depth = depth; }
+
+	// Score programs on count cases (call before initialise), each one
+	// after the first on its own generated map (newMaps) or from its own
+	// start on the shown map
+	void setFitnessCases(int count, bool newMaps) { caseCount = count; caseMaps = newMaps; }
+
+	// How the case scores are combined, and how many cases are sampled
+	// each generation (0 == all)
+	void setCaseReducer(PFitnessCases::Reducer reducer) { caseReducer = reducer; }
+	void setCaseSample(int n) { caseSample = n; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,699 @@
+// ---------------------------------------------------------------------
+// PBenchmark Implementation
+// ---------------------------------------------------------------------
+
+#include "PBenchmark.h"
+
+// Other includes
+#include "Pathfinding.h"
+#include "HierarchicalPathfinding.h"
+#include "IncrementalPathfinding.h"
+#include "PFlowField.h"
+#include "PathBatch.h"
+#include "PWavefront.h"
+#include "PScenario.h"
+#include "PMapGenerator.h"
+
+#include <time.h>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// Namespace use
+using namespace std;
+using namespace CoreStructures;
+
+// Grid searched by the map check (Pathfinding takes a plain function)
+static const PGrid* searchGrid = NULL;
+
+// Map check
+// Precondition: searchGrid set
+// Postcondition: Returns true if the cell is blocked
+static bool checkGrid(int x, int z)
+{
+	return searchGrid->isBlocked(x, z);
+}
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Next (xorshift, kept apart from rand() so the GP runs aren't disturbed)
+unsigned int PBenchmark::next()
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+// Generate
+// Precondition: n/a
+// Postcondition: grid resized with wallPercent of its cells walled
+void PBenchmark::generate(int width, int depth, int wallPercent)
+{
+	PMapGenerator generator(seed);
+	generator.randomFill(grid, width, depth, wallPercent);
+
+	// Queries carry on from the same sequence
+	seed = generator.getSeed();
+}
+
+// Random Cell
+// Precondition: grid has at least one open cell
+// Postcondition: x/z set to an open cell
+void PBenchmark::randomCell(int& x, int& z)
+{
+	do
+	{
+		x = next() % grid.getWidth();
+		z = next() % grid.getDepth();
+	}
+	while(grid.isWall(x, z));
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PBenchmark::PBenchmark()
+{
+	seed = 2463534242u;
+}
+
+// Deconstructor
+PBenchmark::~PBenchmark()
+{
+	// EMPTY
+}
+
+// Searches
+// Precondition: n/a
+// Postcondition: Expansions and time for each search output
+void PBenchmark::searches(int size, int wallPercent, int queries)
+{
+	const char* names[] = { "A*", "JPS", "JPS+", "Bidirectional" };
+
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+
+	// Same queries for every search
+	std::vector<int> cells;
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		int sx, sz, ex, ez;
+		randomCell(sx, sz);
+		randomCell(ex, ez);
+
+		cells.push_back(sx);
+		cells.push_back(sz);
+		cells.push_back(ex);
+		cells.push_back(ez);
+	}
+
+	searchGrid = &grid;
+
+	cout << "Searches: " << size << " x " << size << ", " << wallPercent << "% walls, " << queries << " queries" << endl;
+
+	for(int mode = Pathfinding::SEARCH_ASTAR; mode <= Pathfinding::SEARCH_BIDIRECTIONAL; mode += 1)
+	{
+		Pathfinding pf;
+		pf.setMapSize(size, size);
+		pf.attachMapCheck(checkGrid);
+		pf.setSearchMode((Pathfinding::SearchMode)mode);
+
+		clock_t t = clock();
+
+		// The table is part of the JPS+ cost, though it's only built once per map
+		if(mode == Pathfinding::SEARCH_JPS_PLUS)
+			pf.Preprocess();
+
+		clock_t preprocess = clock() - t;
+
+		long expanded = 0, length = 0;
+		int found = 0;
+
+		for(int i = 0; i < queries; i += 1)
+		{
+			pf.FindPath(GUVector4(cells[i * 4], 0, cells[i * 4 + 1]), GUVector4(cells[i * 4 + 2], 0, cells[i * 4 + 3]));
+
+			expanded += pf.getExpanded();
+
+			if(pf.endFound)
+			{
+				found += 1;
+				length += pf.getPathLength();
+			}
+		}
+
+		t = clock() - t;
+
+		cout << "  " << names[mode] << ": " << found << " found, path length " << length
+			<< ", expanded " << expanded << ", " << 1000.0 * t / CLOCKS_PER_SEC << "ms";
+
+		if(mode == Pathfinding::SEARCH_JPS_PLUS)
+			cout << " (table " << 1000.0 * preprocess / CLOCKS_PER_SEC << "ms)";
+
+		cout << endl;
+	}
+
+	searchGrid = NULL;
+}
+
+// Nearest
+// Precondition: n/a
+// Postcondition: Nearest goal search times output
+void PBenchmark::nearest(int size, int wallPercent, int queries, int goals)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+	searchGrid = &grid;
+
+	cout << "Nearest goal: " << size << " x " << size << ", " << wallPercent << "% walls, "
+		<< queries << " queries, " << goals << " goals" << endl;
+
+	Pathfinding pf;
+	pf.setMapSize(size, size);
+	pf.attachMapCheck(checkGrid);
+
+	std::vector<GUVector4> starts;
+	std::vector<GUVector4> targets;
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		int x, z;
+		randomCell(x, z);
+		starts.push_back(GUVector4(x, 0, z));
+	}
+
+	for(int i = 0; i < goals; i += 1)
+	{
+		int x, z;
+		randomCell(x, z);
+		targets.push_back(GUVector4(x, 0, z));
+	}
+
+	// A search to every goal, keeping the shortest
+	long eachLength = 0, eachExpanded = 0;
+	clock_t t = clock();
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		int best = -1;
+
+		for(int g = 0; g < goals; g += 1)
+		{
+			pf.FindPath(starts[i], targets[g]);
+			eachExpanded += pf.getExpanded();
+
+			if(pf.endFound && (best < 0 || pf.getPathLength() < best))
+				best = pf.getPathLength();
+		}
+
+		if(best >= 0)
+			eachLength += best;
+	}
+
+	clock_t tEach = clock() - t;
+
+	// One search that stops at the first goal
+	long nearestLength = 0, nearestExpanded = 0;
+	t = clock();
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		pf.FindPathToNearest(starts[i], targets);
+		nearestExpanded += pf.getExpanded();
+
+		if(pf.endFound)
+			nearestLength += pf.getPathLength();
+	}
+
+	clock_t tNearest = clock() - t;
+
+	cout << "  A* per goal: " << 1000.0 * tEach / CLOCKS_PER_SEC << "ms, expanded " << eachExpanded
+		<< ", total length " << eachLength << endl;
+	cout << "  Nearest goal: " << 1000.0 * tNearest / CLOCKS_PER_SEC << "ms, expanded " << nearestExpanded
+		<< ", total length " << nearestLength << endl;
+
+	searchGrid = NULL;
+}
+
+// Hierarchy
+// Precondition: n/a
+// Postcondition: HPA* build, query and rebuild times output
+void PBenchmark::hierarchy(int size, int wallPercent, int queries)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+	searchGrid = &grid;
+
+	cout << "Hierarchy: " << size << " x " << size << ", " << wallPercent << "% walls, " << queries << " queries" << endl;
+
+	HierarchicalPathfinding hpa;
+	hpa.attachMapCheck(checkGrid);
+	hpa.setMapSize(size, size);
+
+	clock_t t = clock();
+	hpa.Build();
+	t = clock() - t;
+
+	cout << "  Build: " << hpa.getNodes() << " entrances, " << 1000.0 * t / CLOCKS_PER_SEC << "ms" << endl;
+
+	Pathfinding pf;
+	pf.setMapSize(size, size);
+	pf.attachMapCheck(checkGrid);
+
+	long optimal = 0, length = 0;
+	clock_t tFlat = 0, tHierarchy = 0;
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		int sx, sz, ex, ez;
+		randomCell(sx, sz);
+		randomCell(ex, ez);
+
+		t = clock();
+		pf.FindPath(GUVector4(sx, 0, sz), GUVector4(ex, 0, ez));
+		tFlat += clock() - t;
+
+		t = clock();
+		hpa.FindPath(GUVector4(sx, 0, sz), GUVector4(ex, 0, ez));
+		tHierarchy += clock() - t;
+
+		if(pf.endFound && hpa.endFound)
+		{
+			optimal += pf.getPathLength();
+			length += hpa.getPathLength();
+		}
+	}
+
+	cout << "  A*: " << 1000.0 * tFlat / CLOCKS_PER_SEC / queries << "ms per query" << endl;
+	cout << "  HPA*: " << 1000.0 * tHierarchy / CLOCKS_PER_SEC / queries << "ms per query, paths "
+		<< (optimal ? 100.0 * (length - optimal) / optimal : 0.0) << "% longer" << endl;
+
+	// Toggle a cell and rebuild only what it touches
+	int rebuilt = hpa.getRebuilt();
+	int x = size / 2;
+	int z = size / 2;
+
+	grid.setWall(x, z, !grid.isWall(x, z));
+	hpa.CellChanged(x, z);
+
+	t = clock();
+	hpa.Build();
+	t = clock() - t;
+
+	cout << "  Wall change: " << hpa.getRebuilt() - rebuilt << " sectors rebuilt, " << 1000.0 * t / CLOCKS_PER_SEC << "ms" << endl;
+
+	searchGrid = NULL;
+}
+
+// Replanning
+// Precondition: n/a
+// Postcondition: Cells expanded/touched and time per update output
+void PBenchmark::replanning(int size, int wallPercent, int updates)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+	searchGrid = &grid;
+
+	// Corner to corner
+	grid.setWall(0, 0, 0);
+	grid.setWall(size - 1, size - 1, 0);
+
+	cout << "Replanning: " << size << " x " << size << ", " << wallPercent << "% walls, " << updates << " updates" << endl;
+
+	IncrementalPathfinding dstar;
+	dstar.setMapSize(size, size);
+	dstar.attachMapCheck(checkGrid);
+
+	Pathfinding pf;
+	pf.setMapSize(size, size);
+	pf.attachMapCheck(checkGrid);
+
+	GUVector4 position(0, 0, 0);
+	GUVector4 goal(size - 1, 0, size - 1);
+
+	clock_t t = clock();
+	dstar.FindPath(position, goal);
+	t = clock() - t;
+
+	cout << "  First search: expanded " << dstar.getExpanded() << ", " << 1000.0 * t / CLOCKS_PER_SEC << "ms" << endl;
+
+	long expanded = 0, touched = 0, flatExpanded = 0;
+	int mismatched = 0;
+	clock_t tIncremental = 0, tFlat = 0;
+
+	for(int i = 0; i < updates && dstar.endFound; i += 1)
+	{
+		// Step along the path
+		dstar.ResetPath();
+		dstar.GetNextPosition();
+		position = dstar.GetNextPosition();
+
+		// Change a cell near the agent
+		int x = (int)position.x + (int)(next() % 21) - 10;
+		int z = (int)position.z + (int)(next() % 21) - 10;
+
+		if(grid.inside(x, z) && !(x == (int)position.x && z == (int)position.z) && !(x == size - 1 && z == size - 1))
+		{
+			grid.setWall(x, z, !grid.isWall(x, z));
+			dstar.CellChanged(x, z);
+		}
+
+		t = clock();
+		dstar.FindPath(position, goal);
+		tIncremental += clock() - t;
+
+		t = clock();
+		pf.FindPath(position, goal);
+		tFlat += clock() - t;
+
+		expanded += dstar.getExpanded();
+		touched += dstar.getTouched();
+		flatExpanded += pf.getExpanded();
+
+		if(dstar.getPathLength() != (pf.endFound ? pf.getPathLength() : -1))
+			mismatched += 1;
+	}
+
+	cout << "  D* Lite: expanded " << expanded << ", touched " << touched << ", "
+		<< 1000.0 * tIncremental / CLOCKS_PER_SEC << "ms" << endl;
+	cout << "  A*: expanded " << flatExpanded << ", " << 1000.0 * tFlat / CLOCKS_PER_SEC << "ms" << endl;
+
+	if(mismatched)
+		cout << "  " << mismatched << " path lengths differed" << endl;
+
+	searchGrid = NULL;
+}
+
+// Flow Field
+// Precondition: n/a
+// Postcondition: Time for every agent's whole path output for both
+void PBenchmark::flowField(int size, int wallPercent, int agents)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+	searchGrid = &grid;
+
+	// Everyone heads for (0, 0), as in the path problem
+	grid.setWall(0, 0, 0);
+
+	cout << "Flow field: " << size << " x " << size << ", " << wallPercent << "% walls, " << agents << " agents" << endl;
+
+	std::vector<int> starts;
+
+	for(int i = 0; i < agents; i += 1)
+	{
+		int x, z;
+		randomCell(x, z);
+		starts.push_back(x);
+		starts.push_back(z);
+	}
+
+	Pathfinding pf;
+	pf.setMapSize(size, size);
+	pf.attachMapCheck(checkGrid);
+
+	long flatLength = 0, fieldLength = 0;
+
+	clock_t t = clock();
+
+	for(int i = 0; i < agents; i += 1)
+	{
+		pf.FindPath(GUVector4(starts[i * 2], 0, starts[i * 2 + 1]), GUVector4(0, 0, 0));
+
+		if(pf.endFound)
+			flatLength += pf.getPathLength();
+	}
+
+	clock_t tFlat = clock() - t;
+
+	// Build once, then every agent walks its whole path
+	PFlowField field;
+	t = clock();
+
+	for(int i = 0; i < agents; i += 1)
+	{
+		field.update(grid, 0, 0);
+
+		int x = starts[i * 2];
+		int z = starts[i * 2 + 1];
+
+		while(field.step(x, z))
+			fieldLength += 1;
+	}
+
+	clock_t tField = clock() - t;
+
+	cout << "  A*: " << 1000.0 * tFlat / CLOCKS_PER_SEC << "ms, total length " << flatLength << endl;
+	cout << "  Flow field: " << 1000.0 * tField / CLOCKS_PER_SEC << "ms, total length " << fieldLength
+		<< ", built " << field.getBuilds() << " time(s)" << endl;
+
+	searchGrid = NULL;
+}
+
+// Batch
+// Precondition: n/a
+// Postcondition: Queries per second for one and many threads output
+void PBenchmark::batch(int size, int wallPercent, int queries)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+	searchGrid = &grid;
+
+	std::vector<PathBatch::Query> batch;
+
+	for(int i = 0; i < queries; i += 1)
+	{
+		PathBatch::Query q;
+
+		// Every fourth query asks an earlier one again
+		if(i % 4 == 3)
+		{
+			q = batch[next() % batch.size()];
+		}
+		else
+		{
+			randomCell(q.startX, q.startZ);
+			randomCell(q.goalX, q.goalZ);
+		}
+
+		batch.push_back(q);
+	}
+
+	cout << "Batch: " << size << " x " << size << ", " << wallPercent << "% walls, " << queries << " queries" << endl;
+
+	// One worker, then one per core
+	for(int pass = 0; pass < 2; pass += 1)
+	{
+		PathBatch paths(pass == 0 ? 1 : 0);
+		paths.setMap(checkGrid, size, size);
+		paths.run(batch);
+
+		cout << "  " << paths.getThreads() << " thread(s): " << paths.getDistinct() << " distinct, "
+			<< paths.getQueriesPerSecond() << " queries/s" << endl;
+	}
+
+	searchGrid = NULL;
+}
+
+// Wavefront
+// Precondition: n/a
+// Postcondition: Time per distance table and per check output
+void PBenchmark::wavefront(int size, int wallPercent, int repeats)
+{
+	seed = 2463534242u;
+	generate(size, size, wallPercent);
+
+	int goalX, goalZ;
+	randomCell(goalX, goalZ);
+
+	cout << "Wavefront: " << size << " x " << size << ", " << wallPercent << "% walls, "
+		<< (PWavefront::usingAVX2() ? "AVX2" : "scalar") << endl;
+
+	// Distance tables
+	PFlowField field;
+	PWavefront wave;
+	std::vector<int> distance;
+
+	clock_t t = clock();
+
+	for(int i = 0; i < repeats; i += 1)
+	{
+		// A new version each time so the field really rebuilds
+		grid.setWall(goalX, goalZ, 0);
+		field.update(grid, goalX, goalZ);
+	}
+
+	clock_t tQueue = clock() - t;
+
+	t = clock();
+
+	for(int i = 0; i < repeats; i += 1)
+		wave.distances(grid, goalX, goalZ, distance);
+
+	clock_t tWave = clock() - t;
+
+	int mismatched = 0;
+
+	for(int z = 0; z < size; z += 1)
+		for(int x = 0; x < size; x += 1)
+			if(distance[z * size + x] != field.getDistance(x, z))
+				mismatched += 1;
+
+	cout << "  Queue: " << 1000.0 * tQueue / CLOCKS_PER_SEC / repeats << "ms per table" << endl;
+	cout << "  Wavefront: " << 1000.0 * tWave / CLOCKS_PER_SEC / repeats << "ms per table, "
+		<< mismatched << " distances differ" << endl;
+
+	// Reachability between random cells
+	int reachable = 0;
+	t = clock();
+
+	for(int i = 0; i < repeats * 10; i += 1)
+	{
+		int x, z;
+		randomCell(x, z);
+
+		if(wave.reachable(grid, x, z, goalX, goalZ))
+			reachable += 1;
+	}
+
+	t = clock() - t;
+
+	cout << "  Reachable: " << reachable << " of " << repeats * 10 << ", "
+		<< 1000.0 * t / CLOCKS_PER_SEC / (repeats * 10) << "ms per check" << endl;
+}
+
+// Scenarios
+// Precondition: n/a
+// Postcondition: Results per search mode and bucket written to outFile
+bool PBenchmark::scenarios(const char* mapFile, const char* scenFile, const char* outFile)
+{
+	const char* names[] = { "A*", "JPS", "JPS+", "Bidirectional" };
+
+	PScenario scenario;
+
+	if(!PScenario::loadMap(mapFile, grid) || !scenario.load(scenFile))
+	{
+		cout << "Scenarios: couldn't read " << mapFile << " or " << scenFile << endl;
+		return false;
+	}
+
+	ofstream out(outFile);
+
+	if(!out)
+	{
+		cout << "Scenarios: couldn't write " << outFile << endl;
+		return false;
+	}
+
+	searchGrid = &grid;
+
+	int width = grid.getWidth();
+	int depth = grid.getDepth();
+
+	// Queries for this map. The .scen lengths allow diagonal moves, the
+	// searches here don't, so the expected length of each query is
+	// found with breadth first search (it can't be less than the .scen
+	// length, if it is the files don't match).
+	std::vector<int> queries;
+	std::vector<int> expected;
+	int buckets = 0, skipped = 0;
+	PFlowField field;
+
+	for(int i = 0; i < scenario.getCount(); i += 1)
+	{
+		const PScenario::Entry& e = scenario.getEntry(i);
+
+		if(e.width != width || e.depth != depth || !grid.inside(e.startX, e.startZ) || !grid.inside(e.goalX, e.goalZ) || e.bucket < 0)
+		{
+			skipped += 1;
+			continue;
+		}
+
+		field.update(grid, e.goalX, e.goalZ);
+
+		int length = field.getDistance(e.startX, e.startZ);
+
+		if(length != PFlowField::UNREACHABLE && length < e.optimal - 0.001)
+		{
+			skipped += 1;
+			continue;
+		}
+
+		queries.push_back(i);
+		expected.push_back(length);
+		buckets = max(buckets, e.bucket + 1);
+	}
+
+	cout << "Scenarios: " << mapFile << ", " << width << " x " << depth << ", "
+		<< queries.size() << " queries (" << skipped << " skipped)" << endl;
+
+	out << "mode,bucket,queries,failed,expanded,microseconds_per_query,memory_bytes" << endl;
+
+	for(int mode = Pathfinding::SEARCH_ASTAR; mode <= Pathfinding::SEARCH_BIDIRECTIONAL; mode += 1)
+	{
+		Pathfinding pf;
+		pf.setMapSize(width, depth);
+		pf.attachMapCheck(checkGrid);
+		pf.setSearchMode((Pathfinding::SearchMode)mode);
+
+		if(mode == Pathfinding::SEARCH_JPS_PLUS)
+			pf.Preprocess();
+
+		// Totals per bucket
+		std::vector<int> count(buckets, 0);
+		std::vector<int> failed(buckets, 0);
+		std::vector<long long> expanded(buckets, 0);
+		std::vector<double> seconds(buckets, 0.0);
+
+		for(unsigned int q = 0; q < queries.size(); q += 1)
+		{
+			const PScenario::Entry& e = scenario.getEntry(queries[q]);
+
+			chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+
+			pf.FindPath(GUVector4(e.startX, 0, e.startZ), GUVector4(e.goalX, 0, e.goalZ));
+
+			seconds[e.bucket] += chrono::duration<double>(chrono::high_resolution_clock::now() - begin).count();
+
+			int length = pf.endFound ? pf.getPathLength() : PFlowField::UNREACHABLE;
+
+			count[e.bucket] += 1;
+			expanded[e.bucket] += pf.getExpanded();
+
+			if(length != expected[q])
+				failed[e.bucket] += 1;
+		}
+
+		int totalFailed = 0;
+		double totalSeconds = 0;
+
+		for(int b = 0; b < buckets; b += 1)
+		{
+			totalFailed += failed[b];
+			totalSeconds += seconds[b];
+
+			if(count[b] == 0)
+				continue;
+
+			out << names[mode] << "," << b << "," << count[b] << "," << failed[b] << "," << expanded[b] << ","
+				<< 1.0e6 * seconds[b] / count[b] << "," << pf.getMemoryUsed() << endl;
+		}
+
+		cout << "  " << names[mode] << ": " << totalFailed << " wrong length(s), "
+			<< (queries.empty() ? 0.0 : 1.0e6 * totalSeconds / queries.size()) << "us per query, "
+			<< pf.getMemoryUsed() << " bytes" << endl;
+	}
+
+	searchGrid = NULL;
+
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef PBENCHMARK
+#define PBENCHMARK
+
+// Includes
+#include "PGrid.h"
+
+// ---------------------------------------------------------------------
+// PBenchmark (Project Benchmark) - Times the pathfinding searches on
+// generated maps larger than the 20 x 20 level
+// ---------------------------------------------------------------------
+
+class PBenchmark
+{
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	// Map being searched
+	PGrid grid;
+
+	// Seed for map and query generation (same maps every run)
+	unsigned int seed;
+
+	// METHODS
+
+	// Next pseudo random number
+	unsigned int next();
+
+	// Fill the grid with randomly placed walls
+	void generate(int width, int depth, int wallPercent);
+
+	// Pick a random open cell
+	void randomCell(int& x, int& z);
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	PBenchmark();
+	~PBenchmark();
+
+	// Compare A*, JPS, JPS+ and bidirectional A* node expansions and time
+	void searches(int size = 256, int wallPercent = 20, int queries = 100);
+
+	// Find the nearest of several goals, with one A* per goal and with
+	// one nearest goal search
+	void nearest(int size = 256, int wallPercent = 20, int queries = 100, int goals = 16);
+
+	// Compare HPA* with A*, and time rebuilding after a wall changes
+	void hierarchy(int size = 512, int wallPercent = 20, int queries = 100);
+
+	// Walk an agent across a map whose walls keep changing, replanning
+	// with D* Lite and with A* from scratch
+	void replanning(int size = 256, int wallPercent = 20, int updates = 100);
+
+	// Send many agents to one goal, with A* each and with a flow field
+	void flowField(int size = 256, int wallPercent = 20, int agents = 200);
+
+	// Batch queries (a quarter of them repeats) on one thread and on
+	// one per core
+	void batch(int size = 256, int wallPercent = 20, int queries = 400);
+
+	// Distance tables and reachability checks, bit-parallel against
+	// queue based breadth first search
+	void wavefront(int size = 1024, int wallPercent = 20, int repeats = 10);
+
+	// Run every query of a .scen file on its .map with each search mode,
+	// checking lengths against breadth first search. Per bucket results
+	// are written to outFile as CSV. Returns false if a file can't be
+	// read or written.
+	bool scenarios(const char* mapFile, const char* scenFile, const char* outFile);
+};
+
+#endif
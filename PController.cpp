@@ -114,6 +114,29 @@ void PController::refreshPop()
 		pathAI.refreshPop();
 }
 
+// Benchmark
+// Precondition: DesertAI and PathAI setup/'B' is pressed
+// Postcondition: Current AI benchmarks output to the debug window
+void PController::benchmark()
+{
+	if(currentAI)
+		desertAI.benchmark();
+	else
+	{
+		pathAI.benchmark();
+		searchBenchmark.searches();
+		searchBenchmark.nearest();
+		searchBenchmark.hierarchy();
+		searchBenchmark.replanning();
+		searchBenchmark.flowField();
+		searchBenchmark.batch();
+		searchBenchmark.wavefront();
+
+		// Standard benchmark maps, if one has been put in place
+		searchBenchmark.scenarios("Resources\\Maps\\benchmark.map", "Resources\\Maps\\benchmark.map.scen", "scenarios.csv");
+	}
+}
+
 // Swap AI
 // Precondition: DesertAI and PathAI setup/left or right arrow key is pressed
 // Postcondition: Current AI swapped
@@ -8,6 +8,7 @@
 #include "PTextures.h"
 
 #include "PAIDesert.h"
+#include "PBenchmark.h"
 
 #include <CoreStructures\GUMatrix4.h>
 #include <CoreStructures\GUVector4.h>
@@ -32,6 +33,9 @@ private:
 	PAIDesert desertAI;
 	bool currentAI;
 
+	// Pathfinding benchmarks
+	PBenchmark searchBenchmark;
+
 	// Map Offset (centres the map when rendering)
 	CoreStructures::GUVector4 mapOffset;
 
@@ -62,6 +66,9 @@ public:
 	// Create new population
 	void refreshPop();
 
+	// Run benchmarks
+	void benchmark();
+
 	// Swap AI
 	void swapAI();
 };
@@ -0,0 +1,76 @@
+
+// ---------------------------------------------------------------------
+// PCycleDetector Implementation
+// ---------------------------------------------------------------------
+
+#include "PCycleDetector.h"
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PCycleDetector::PCycleDetector(int maxSteps)
+{
+	// Table at least twice as large as the number of states
+	unsigned int size = 16;
+
+	while(size < (unsigned int)maxSteps * 2)
+		size *= 2;
+
+	table = new Entry[size];
+	mask = size - 1;
+
+	for(unsigned int i = 0; i < size; i += 1)
+		table[i].stamp = 0;
+
+	stamp = 0;
+	begin();
+}
+
+// Deconstructor
+PCycleDetector::~PCycleDetector()
+{
+	delete[] table;
+}
+
+// Begin
+// Precondition: n/a
+// Postcondition: No states are recorded
+void PCycleDetector::begin()
+{
+	stamp += 1;
+
+	// Stamp wrapped round, old entries would look current
+	if(stamp == 0)
+	{
+		for(unsigned int i = 0; i <= mask; i += 1)
+			table[i].stamp = 0;
+
+		stamp = 1;
+	}
+}
+
+// Visit
+// Precondition: Fewer than maxSteps states recorded since begin()
+// Postcondition: State recorded, earlier step returned if it repeats
+int PCycleDetector::visit(unsigned long long state, int step)
+{
+	// Mix the bits so neighbouring cells spread over the table
+	unsigned long long h = state * 0x9E3779B97F4A7C15ull;
+	unsigned int i = (unsigned int)(h >> 32) & mask;
+
+	while(table[i].stamp == stamp)
+	{
+		if(table[i].state == state)
+			return table[i].step;
+
+		i = (i + 1) & mask;
+	}
+
+	table[i].state = state;
+	table[i].step = step;
+	table[i].stamp = stamp;
+
+	return -1;
+}
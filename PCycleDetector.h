@@ -0,0 +1,47 @@
+#pragma once
+#ifndef PCYCLEDETECTOR
+#define PCYCLEDETECTOR
+
+// ---------------------------------------------------------------------
+// PCycleDetector (Project Cycle Detector) - Spots when a repeated program
+// run returns to a simulation state it has already been in
+// ---------------------------------------------------------------------
+
+class PCycleDetector
+{
+// ---------------------------------------------------------------------
+private:
+
+	// Hash table entry, only valid when stamp matches
+	struct Entry
+	{
+		unsigned long long state;
+		int step;
+		unsigned int stamp;
+	};
+
+	// ATTRIBUTES
+
+	Entry* table;
+	unsigned int mask;
+
+	// Current generation stamp, bumping it empties the table
+	unsigned int stamp;
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	// maxSteps - the most states recorded between begin() calls
+	PCycleDetector(int maxSteps = 512);
+	~PCycleDetector();
+
+	// Forget every recorded state
+	void begin();
+
+	// Record the state at a step, returns the earlier step the
+	// same state was seen at (or -1 if it is new)
+	int visit(unsigned long long state, int step);
+};
+
+#endif
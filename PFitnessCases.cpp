@@ -0,0 +1,276 @@
+// ---------------------------------------------------------------------
+// PFitnessCases Implementation
+// ---------------------------------------------------------------------
+
+#include "PFitnessCases.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+// Namespace use
+using namespace std;
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Work
+// Wait for a program, help score it, repeat until stopped
+void PFitnessCases::work(int index)
+{
+	unsigned int seen = 0;
+
+	while(true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+
+			while(!stopping && batch == seen)
+				wake.wait(guard);
+
+			if(stopping)
+				return;
+
+			seen = batch;
+		}
+
+		// The frames may have moved since the last program
+		TerminalSet::frame = &frames[index * Tset.n];
+		score();
+		TerminalSet::frame = NULL;
+
+		{
+			lock_guard<mutex> guard(lock);
+
+			running -= 1;
+
+			if(running == 0)
+				done.notify_all();
+		}
+	}
+}
+
+// Score
+void PFitnessCases::score()
+{
+	int u;
+
+	while((u = next++) < (int)active.size())
+		scores[u] = fitnessOf(program, active[u], &hits[u]);
+}
+
+// Start Workers
+// Precondition: No workers running
+// Postcondition: threads - 1 workers waiting (the caller is the other)
+void PFitnessCases::startWorkers(int threads)
+{
+	stopping = false;
+	batch = 0;
+	running = 0;
+
+	for(int i = 0; i < threads - 1; i += 1)
+		workers.push_back(thread(&PFitnessCases::work, this, i));
+}
+
+// Stop Workers
+// Precondition: n/a
+// Postcondition: Every worker joined
+void PFitnessCases::stopWorkers()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for(unsigned int i = 0; i < workers.size(); i += 1)
+		workers[i].join();
+
+	workers.clear();
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PFitnessCases::PFitnessCases()
+{
+	fitnessOf = NULL;
+	count = 0;
+	reducer = REDUCE_SUM;
+	sampleSize = 0;
+	position = 0;
+
+	batch = 0;
+	running = 0;
+	stopping = false;
+	program = NULL;
+	next = 0;
+}
+
+// Deconstructor
+PFitnessCases::~PFitnessCases()
+{
+	stopWorkers();
+}
+
+// Setup
+// Precondition: No program being scored
+// Postcondition: Every case active, workers ready
+void PFitnessCases::setup(caseFitness func, int count, int threads)
+{
+	stopWorkers();
+
+	fitnessOf = func;
+	this->count = count;
+
+	order.resize(count);
+
+	for(int i = 0; i < count; i += 1)
+		order[i] = i;
+
+	position = count;
+
+	if(threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+
+	startWorkers(min(threads, count));
+	sample();
+}
+
+// Set Sample Size
+// Precondition: n/a
+// Postcondition: sample() picks n cases
+void PFitnessCases::setSampleSize(int n)
+{
+	sampleSize = n;
+	sample();
+}
+
+// Sample
+// Precondition: n/a
+// Postcondition: sampleSize different cases active, in order
+void PFitnessCases::sample()
+{
+	if(sampleSize <= 0 || sampleSize >= count)
+	{
+		active = order;
+		sort(active.begin(), active.end());
+		return;
+	}
+
+	// Reshuffle once the order runs out (cases left over wait for a
+	// later order)
+	if(position + sampleSize > count)
+	{
+		// random() only has ten values, so draw the index from rand()
+		// (two of them, it can be as small as 15 bits)
+		for(int i = count - 1; i > 0; i -= 1)
+			swap(order[i], order[(((unsigned int)rand() << 15) ^ rand()) % (i + 1)]);
+
+		position = 0;
+	}
+
+	active.assign(order.begin() + position, order.begin() + position + sampleSize);
+	sort(active.begin(), active.end());
+
+	position += sampleSize;
+}
+
+// Evaluate
+// Precondition: Setup
+// Postcondition: Returns the combined score of the active cases
+float PFitnessCases::evaluate(S_Expression* s, int* hits)
+{
+	int cases = active.size();
+
+	if(cases == 0)
+		return 0;
+
+	program = s;
+	next = 0;
+	scores.assign(cases, 0);
+	this->hits.assign(cases, 0);
+
+	if(workers.empty())
+		score();
+	else
+	{
+		// Every thread starts from the current terminal values
+		int threads = workers.size() + 1;
+		frames.resize(threads * Tset.n);
+
+		for(int i = 0; i < threads; i += 1)
+			Tset.fill_frame(&frames[i * Tset.n]);
+
+		// Nodes can now be counted by several threads at once
+		int profiling = S_Expression::profiling;
+
+		if(profiling)
+			S_Expression::profiling = 2;
+
+		{
+			lock_guard<mutex> guard(lock);
+
+			running = workers.size();
+			batch += 1;
+		}
+
+		wake.notify_all();
+
+		// Score cases here too
+		TerminalSet::frame = &frames[(threads - 1) * Tset.n];
+		score();
+		TerminalSet::frame = NULL;
+
+		{
+			unique_lock<mutex> guard(lock);
+
+			while(running > 0)
+				done.wait(guard);
+		}
+
+		S_Expression::profiling = profiling;
+	}
+
+	// Combine
+	float total = 0;
+	float worst = scores[0];
+
+	for(int i = 0; i < cases; i += 1)
+	{
+		total += scores[i];
+		worst = max(worst, scores[i]);
+		*hits += this->hits[i];
+	}
+
+	program = NULL;
+
+	if(reducer == REDUCE_WORST)
+		return worst;
+	else if(reducer == REDUCE_MEAN)
+		return total / cases;
+	else
+		return total;
+}
+
+// Evaluate All
+// Precondition: Setup
+// Postcondition: Returns the combined score of every case, the sample
+// is unchanged
+float PFitnessCases::evaluateAll(S_Expression* s, int* hits)
+{
+	vector<int> sampled;
+	sampled.swap(active);
+
+	active = order;
+	sort(active.begin(), active.end());
+
+	float fitness = evaluate(s, hits);
+
+	active.swap(sampled);
+
+	return fitness;
+}
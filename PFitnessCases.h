@@ -0,0 +1,117 @@
+#pragma once
+#ifndef PFITNESSCASES
+#define PFITNESSCASES
+
+// Includes
+#include "gp.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// Fitness of a program on one case (adds to hits if it scored one)
+typedef float (*caseFitness)(S_Expression* s, int fitnessCase, int* hits);
+
+// ---------------------------------------------------------------------
+// PFitnessCases (Project Fitness Cases) - Scores a program on several
+// fitness cases (maps, start positions...) and combines the scores.
+// The cases are run at the same time on a pool of worker threads, each
+// with its own terminal values (TerminalSet::frame), so the case
+// function must keep any other state it changes per thread. Each
+// generation can use a sample of the cases, taken in turn from a
+// shuffled order so every case gets used as often as the others.
+// ---------------------------------------------------------------------
+
+class PFitnessCases
+{
+public:
+
+	// How the case scores become one fitness (lower is better)
+	enum Reducer
+	{
+		REDUCE_SUM,
+		REDUCE_WORST,
+		REDUCE_MEAN
+	};
+
+private:
+
+	// ATTRIBUTES
+
+	caseFitness fitnessOf;
+	int count;
+	Reducer reducer;
+
+	// Cases scored this generation (sampleSize of them, 0 == all),
+	// the next sample starts at position in order
+	int sampleSize;
+	std::vector<int> active;
+	std::vector<int> order;
+	int position;
+
+	// Workers, and the signal that a program is ready or they should stop
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned int batch;
+	int running;
+	bool stopping;
+
+	// Current program, each thread takes the next unscored case
+	S_Expression* program;
+	std::atomic<int> next;
+	std::vector<float> scores;
+	std::vector<int> hits;
+
+	// Terminal values of each thread (the caller's frame is last)
+	std::vector<float> frames;
+
+	// METHODS
+
+	// Worker thread
+	void work(int index);
+
+	// Score the active cases until there are none left
+	void score();
+
+	// Start or stop the workers
+	void startWorkers(int threads);
+	void stopWorkers();
+
+public:
+
+	// Constructor/Deconstructor
+	PFitnessCases();
+	~PFitnessCases();
+
+	// Case function and how many cases it has, threads is the most
+	// that run at once (0 == one per core, 1 == run on the caller)
+	void setup(caseFitness func, int count, int threads = 0);
+
+	// How the case scores are combined
+	void setReducer(Reducer reducer) { this->reducer = reducer; }
+
+	// Score a sample of n cases (0 == every case), chosen by sample()
+	void setSampleSize(int n);
+
+	// Choose the cases to score from now on (the next n of the order,
+	// reshuffled once too few are left)
+	void sample();
+
+	// Score a program on the active cases, adding their hits to hits
+	float evaluate(S_Expression* s, int* hits);
+
+	// Score a program on every case (whatever the sample)
+	float evaluateAll(S_Expression* s, int* hits);
+
+	// Cases
+	int getCount() const { return count; }
+	int getActive() const { return (int)active.size(); }
+	int getActiveCase(int i) const { return active[i]; }
+	int getThreads() const { return (int)workers.size() + 1; }
+};
+
+#endif
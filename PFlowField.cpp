@@ -0,0 +1,244 @@
+// ---------------------------------------------------------------------
+// PFlowField Implementation
+// ---------------------------------------------------------------------
+
+#include "PFlowField.h"
+
+// Namespace use
+using namespace std;
+using namespace CoreStructures;
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Build
+// Precondition: grid and goal set
+// Postcondition: distance and direction filled in for every cell
+void PFlowField::build()
+{
+	width = grid->getWidth();
+	depth = grid->getDepth();
+
+	distance.assign(width * depth, UNREACHABLE);
+	direction.assign(width * depth, FLOW_NONE);
+	queue.clear();
+
+	builds += 1;
+
+	if(grid->isBlocked(goalX, goalZ))
+	{
+		return;
+	}
+
+	int goal = goalZ * width + goalX;
+	distance[goal] = 0;
+	direction[goal] = FLOW_GOAL;
+	queue.push_back(goal);
+
+	// Each cell found points back at the cell it was found from
+	for(unsigned int head = 0; head < queue.size(); head += 1)
+	{
+		int cell = queue[head];
+		int x = cell % width;
+		int z = cell / width;
+		int next = distance[cell] + 1;
+
+		// The cell to the south steps north to get here, and so on
+		if(!grid->isBlocked(x, z + 1) && distance[cell + width] == UNREACHABLE)
+		{
+			distance[cell + width] = next;
+			direction[cell + width] = FLOW_NORTH;
+			queue.push_back(cell + width);
+		}
+
+		if(!grid->isBlocked(x - 1, z) && distance[cell - 1] == UNREACHABLE)
+		{
+			distance[cell - 1] = next;
+			direction[cell - 1] = FLOW_EAST;
+			queue.push_back(cell - 1);
+		}
+
+		if(!grid->isBlocked(x, z - 1) && distance[cell - width] == UNREACHABLE)
+		{
+			distance[cell - width] = next;
+			direction[cell - width] = FLOW_SOUTH;
+			queue.push_back(cell - width);
+		}
+
+		if(!grid->isBlocked(x + 1, z) && distance[cell + 1] == UNREACHABLE)
+		{
+			distance[cell + 1] = next;
+			direction[cell + 1] = FLOW_WEST;
+			queue.push_back(cell + 1);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PFlowField::PFlowField()
+{
+	grid = NULL;
+	version = 0;
+	goalX = goalZ = -1;
+	width = depth = 0;
+	builds = 0;
+}
+
+// Deconstructor
+PFlowField::~PFlowField()
+{
+	// EMPTY
+}
+
+// Update
+// Precondition: Goal is on the grid
+// Postcondition: Field is current for the grid and goal
+bool PFlowField::update(const PGrid& grid, int goalX, int goalZ)
+{
+	if(this->grid == &grid && version == grid.getVersion() && this->goalX == goalX && this->goalZ == goalZ)
+	{
+		return false;
+	}
+
+	this->grid = &grid;
+	this->goalX = goalX;
+	this->goalZ = goalZ;
+	version = grid.getVersion();
+
+	build();
+
+	return true;
+}
+
+// Load
+// Precondition: Goal is on the grid, distances holds a value per cell
+// Postcondition: Field is current for the grid and goal
+bool PFlowField::load(const PGrid& grid, int goalX, int goalZ, const int* distances)
+{
+	this->grid = &grid;
+	this->goalX = goalX;
+	this->goalZ = goalZ;
+	version = grid.getVersion();
+
+	width = grid.getWidth();
+	depth = grid.getDepth();
+
+	distance.assign(distances, distances + width * depth);
+	direction.assign(width * depth, FLOW_NONE);
+
+	int goal = goalZ * width + goalX;
+	bool valid = !grid.isBlocked(goalX, goalZ) && distance[goal] == 0;
+
+	// The distances are the search's only if every open cell is one more
+	// than its nearest open neighbour (or unreachable if none can reach
+	// the goal), so check that while pointing each cell at that neighbour.
+	// Walls are checked to be unreachable as the scan gets to them, so a
+	// neighbour with a distance can be taken to be open, and comparing
+	// unsigned puts UNREACHABLE after every distance.
+	const unsigned int none = (unsigned int)UNREACHABLE;
+
+	for(int z = 0; z < depth && valid; z += 1)
+	{
+		for(int x = 0; x < width && valid; x += 1)
+		{
+			int cell = z * width + x;
+
+			if(grid.isWall(x, z))
+			{
+				valid = distance[cell] == UNREACHABLE;
+				continue;
+			}
+
+			if(cell == goal)
+			{
+				direction[cell] = FLOW_GOAL;
+				continue;
+			}
+
+			unsigned int nearest = none;
+			unsigned char towards = FLOW_NONE;
+
+			if(z > 0 && (unsigned int)distance[cell - width] < nearest)
+			{
+				nearest = distance[cell - width];
+				towards = FLOW_NORTH;
+			}
+
+			if(x + 1 < width && (unsigned int)distance[cell + 1] < nearest)
+			{
+				nearest = distance[cell + 1];
+				towards = FLOW_EAST;
+			}
+
+			if(z + 1 < depth && (unsigned int)distance[cell + width] < nearest)
+			{
+				nearest = distance[cell + width];
+				towards = FLOW_SOUTH;
+			}
+
+			if(x > 0 && (unsigned int)distance[cell - 1] < nearest)
+			{
+				nearest = distance[cell - 1];
+				towards = FLOW_WEST;
+			}
+
+			valid = (unsigned int)distance[cell] == (nearest == none ? none : nearest + 1);
+			direction[cell] = towards;
+		}
+	}
+
+	if(!valid)
+	{
+		build();
+	}
+
+	return valid;
+}
+
+// Step
+// Precondition: Field is current, x/z on the grid
+// Postcondition: x/z moved one cell closer to the goal (if possible)
+bool PFlowField::step(int& x, int& z) const
+{
+	switch(direction[z * width + x])
+	{
+	case FLOW_NORTH:
+		z -= 1;
+		return true;
+
+	case FLOW_EAST:
+		x += 1;
+		return true;
+
+	case FLOW_SOUTH:
+		z += 1;
+		return true;
+
+	case FLOW_WEST:
+		x -= 1;
+		return true;
+	}
+
+	return false;
+}
+
+// Next Position
+GUVector4 PFlowField::GetNextPosition(const GUVector4& pos) const
+{
+	int x = (int)pos.x;
+	int z = (int)pos.z;
+
+	if(x < 0 || z < 0 || x >= width || z >= depth)
+	{
+		return pos;
+	}
+
+	step(x, z);
+
+	return GUVector4(x, 0, z);
+}
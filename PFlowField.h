@@ -0,0 +1,103 @@
+#pragma once
+#ifndef PFLOWFIELD
+#define PFLOWFIELD
+
+// Includes
+#include "PGrid.h"
+
+#include <vector>
+#include <CoreStructures\GUVector4.h>
+
+// ---------------------------------------------------------------------
+// PFlowField (Project Flow Field) - Distance to one goal from every cell
+// of a grid, and the step to take from each cell to get closer. Built
+// with one breadth first search out from the goal, so any number of
+// agents heading for the same goal can each read their next step
+// without searching.
+// ---------------------------------------------------------------------
+
+class PFlowField
+{
+// ---------------------------------------------------------------------
+public:
+
+	// Step to take from a cell
+	enum FlowDirection
+	{
+		FLOW_NONE, // Wall, or can't reach the goal
+		FLOW_GOAL, // At the goal
+		FLOW_NORTH,
+		FLOW_EAST,
+		FLOW_SOUTH,
+		FLOW_WEST
+	};
+
+	// Distance of a cell that can't reach the goal
+	enum { UNREACHABLE = -1 };
+
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	// Grid, version and goal the field was built for
+	const PGrid* grid;
+	unsigned int version;
+	int goalX;
+	int goalZ;
+	int width;
+	int depth;
+
+	// Distance to the goal and step towards it, one per cell
+	std::vector<int> distance;
+	std::vector<unsigned char> direction;
+
+	// Search queue (kept between builds)
+	std::vector<int> queue;
+
+	// Number of times the field has been built
+	int builds;
+
+	// METHODS
+
+	// Breadth first search from the goal
+	void build();
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	PFlowField();
+	~PFlowField();
+
+	// Point the field at a goal. Rebuilt only if the grid, its version
+	// or the goal differ from the last build. Returns true if rebuilt.
+	bool update(const PGrid& grid, int goalX, int goalZ);
+
+	// Take the field from stored distances (one per cell, UNREACHABLE
+	// for walls) instead of searching. They're checked against the grid
+	// and the field built if they aren't its distances to the goal.
+	// Returns true if the stored distances were used.
+	bool load(const PGrid& grid, int goalX, int goalZ, const int* distances);
+
+	// Distance from a cell to the goal (UNREACHABLE if there's no path)
+	int getDistance(int x, int z) const
+	{ return distance[z * width + x]; }
+
+	// Step to take from a cell
+	FlowDirection getDirection(int x, int z) const
+	{ return (FlowDirection)direction[z * width + x]; }
+
+	// Move x/z one step towards the goal, false if there's no step
+	bool step(int& x, int& z) const;
+
+	// Next position for an agent at pos (pos itself if there's no step)
+	CoreStructures::GUVector4 GetNextPosition(const CoreStructures::GUVector4& pos) const;
+
+	// Getters
+	int getGoalX() const { return goalX; }
+	int getGoalZ() const { return goalZ; }
+	int getBuilds() const { return builds; }
+};
+
+#endif
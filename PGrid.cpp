@@ -0,0 +1,183 @@
+
+// ---------------------------------------------------------------------
+// PGrid Implementation
+// ---------------------------------------------------------------------
+
+#include "PGrid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+// Aligned allocation
+// ---------------------------------------------------------------------
+
+// Allocate bytes starting on a cache line, block receives the
+// pointer that has to be freed
+static void* alignedAlloc(size_t bytes, void** block)
+{
+	*block = malloc(bytes + PGrid::CACHE_LINE);
+
+	size_t address = (size_t)*block;
+	address = (address + PGrid::CACHE_LINE - 1) & ~(size_t)(PGrid::CACHE_LINE - 1);
+
+	return (void*)address;
+}
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Release
+// Precondition: n/a
+// Postcondition: Storage freed
+void PGrid::release()
+{
+	free(wallBlock);
+	free(sandBlock);
+
+	wallBlock = sandBlock = NULL;
+	walls = NULL;
+	sand = NULL;
+}
+
+// Copy
+// Precondition: n/a
+// Postcondition: Grid is the same size as, and holds the same cells as, grid
+void PGrid::copy(const PGrid& grid)
+{
+	if(width != grid.width || depth != grid.depth)
+		resize(grid.width, grid.depth);
+
+	memcpy(walls, grid.walls, (size_t)wallStride * depth * sizeof(unsigned long long));
+	memcpy(sand, grid.sand, (size_t)sandStride * depth);
+
+	version += 1;
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructors
+PGrid::PGrid()
+{
+	width = depth = 0;
+	wallStride = sandStride = 0;
+	walls = NULL;
+	sand = NULL;
+	wallBlock = sandBlock = NULL;
+	version = 0;
+
+	resize(0, 0);
+}
+
+PGrid::PGrid(int width, int depth)
+{
+	walls = NULL;
+	sand = NULL;
+	wallBlock = sandBlock = NULL;
+	version = 0;
+
+	resize(width, depth);
+}
+
+PGrid::PGrid(const PGrid& grid)
+{
+	width = depth = -1;
+	walls = NULL;
+	sand = NULL;
+	wallBlock = sandBlock = NULL;
+	version = 0;
+
+	copy(grid);
+}
+
+// Deconstructor
+PGrid::~PGrid()
+{
+	release();
+}
+
+// Assignment
+PGrid& PGrid::operator=(const PGrid& grid)
+{
+	if(this != &grid)
+		copy(grid);
+
+	return *this;
+}
+
+// Resize
+// Precondition: n/a
+// Postcondition: Storage allocated for width x depth cells, all empty
+void PGrid::resize(int width, int depth)
+{
+	release();
+
+	this->width = width;
+	this->depth = depth;
+
+	// Round each row up to whole cache lines
+	int wordsPerLine = CACHE_LINE / sizeof(unsigned long long);
+
+	wallStride = (((width + 63) / 64 + wordsPerLine - 1) / wordsPerLine) * wordsPerLine;
+	sandStride = ((width + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE;
+
+	// Never allocate nothing, so the pointers are always valid
+	walls = (unsigned long long*)alignedAlloc((size_t)wallStride * depth * sizeof(unsigned long long) + 1, &wallBlock);
+	sand = (unsigned char*)alignedAlloc((size_t)sandStride * depth + 1, &sandBlock);
+
+	clear();
+}
+
+// Clear
+// Precondition: n/a
+// Postcondition: No walls or sand on the grid
+void PGrid::clear()
+{
+	memset(walls, 0, (size_t)wallStride * depth * sizeof(unsigned long long));
+	memset(sand, 0, (size_t)sandStride * depth);
+
+	version += 1;
+}
+
+// Set Rows
+// Precondition: wallRows/sandRows hold depth rows of at least width cells
+// Postcondition: Grid holds their cells, bits past the last column clear
+void PGrid::setRows(const unsigned long long* wallRows, int wallStride, const unsigned char* sandRows, int sandStride)
+{
+	int words = (width + 63) / 64;
+	unsigned long long lastMask = (width & 63) ? (1ull << (width & 63)) - 1 : ~0ull;
+
+	for(int z = 0; z < depth && words > 0; z += 1)
+	{
+		unsigned long long* row = walls + z * this->wallStride;
+
+		memcpy(row, wallRows + (size_t)z * wallStride, words * sizeof(unsigned long long));
+		row[words - 1] &= lastMask;
+
+		if(sandRows)
+			memcpy(sand + z * this->sandStride, sandRows + (size_t)z * sandStride, width);
+		else
+			memset(sand + z * this->sandStride, 0, width);
+	}
+
+	version += 1;
+}
+
+// Set wall
+// Precondition: Cell is on the grid
+// Postcondition: Wall bit set or cleared
+void PGrid::setWall(int x, int z, bool wall)
+{
+	unsigned long long bit = 1ull << (x & 63);
+	unsigned long long& word = walls[z * wallStride + (x >> 6)];
+
+	if(wall)
+		word |= bit;
+	else
+		word &= ~bit;
+
+	version += 1;
+}
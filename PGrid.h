@@ -0,0 +1,104 @@
+#pragma once
+#ifndef PGRID
+#define PGRID
+
+// ---------------------------------------------------------------------
+// PGrid (Project Grid) - Runtime sized map shared by the path problem,
+// the desert problem and the level. Walls are stored one bit per cell
+// and sand one byte per cell, both row-major with every row starting
+// on a cache line.
+// ---------------------------------------------------------------------
+
+class PGrid
+{
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	// Dimensions
+	int width;
+	int depth;
+
+	// Row strides (64 bit words of walls, bytes of sand)
+	int wallStride;
+	int sandStride;
+
+	// Cache line aligned storage (and the blocks holding it)
+	unsigned long long* walls;
+	unsigned char* sand;
+	void* wallBlock;
+	void* sandBlock;
+
+	// Bumped on every change, so cached results can be checked
+	unsigned int version;
+
+	// METHODS
+
+	// Release storage
+	void release();
+
+	// Copy another grid's contents
+	void copy(const PGrid& grid);
+
+// ---------------------------------------------------------------------
+public:
+
+	// Bytes per cache line, rows are padded to a multiple of this
+	static const int CACHE_LINE = 64;
+
+	// Constructor/Deconstructor
+	PGrid();
+	PGrid(int width, int depth);
+	PGrid(const PGrid& grid);
+	~PGrid();
+
+	PGrid& operator=(const PGrid& grid);
+
+	// Resize, clearing every cell
+	void resize(int width, int depth);
+
+	// Remove every wall and grain
+	void clear();
+
+	// Copy every row in from another layout (walls wallStride words
+	// apart, sand sandStride bytes apart, sand may be NULL for none)
+	void setRows(const unsigned long long* wallRows, int wallStride, const unsigned char* sandRows, int sandStride);
+
+	// Is the cell on the grid?
+	bool inside(int x, int z) const
+	{ return x >= 0 && z >= 0 && x < width && z < depth; }
+
+	// Walls
+	bool isWall(int x, int z) const
+	{ return (walls[z * wallStride + (x >> 6)] >> (x & 63)) & 1; }
+
+	// Off the grid counts as blocked
+	bool isBlocked(int x, int z) const
+	{ return !inside(x, z) || isWall(x, z); }
+
+	void setWall(int x, int z, bool wall);
+
+	// Sand (0 == none, otherwise the grain colour)
+	unsigned char getSand(int x, int z) const
+	{ return sand[z * sandStride + x]; }
+
+	void setSand(int x, int z, unsigned char colour)
+	{
+		sand[z * sandStride + x] = colour;
+		version += 1;
+	}
+
+	// Getters
+	int getWidth() const { return width; }
+	int getDepth() const { return depth; }
+	int getWallStride() const { return wallStride; }
+	int getSandStride() const { return sandStride; }
+	unsigned int getVersion() const { return version; }
+
+	// Direct row access (for bit-parallel searches)
+	const unsigned long long* wallRow(int z) const { return walls + z * wallStride; }
+	const unsigned char* sandRow(int z) const { return sand + z * sandStride; }
+};
+
+#endif
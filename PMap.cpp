@@ -23,9 +23,7 @@ PMap::PMap()
 {
 	// Set Initial values
 	// Initialise map values
-	for(int i = 0; i < 20; i += 1)
-		for(int j = 0; j < 20; j += 1)
-			map[j][i] = 0;
+	map.resize(20, 20);
 }
 
 // Deconstructor
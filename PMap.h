@@ -5,6 +5,7 @@
 // Include
 #include "PBox.h"
 #include "PGround.h"
+#include "PGrid.h"
 
 #include <CoreStructures\GUVector4.h>
 #include <CoreStructures\GUMatrix4.h>
@@ -31,7 +32,7 @@ private:
 	PBox walls[80];
 
 	// Basic
-	int map[20][20];
+	PGrid map;
 
 // ---------------------------------------------------------------------
 public:
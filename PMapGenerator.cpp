@@ -0,0 +1,336 @@
+// ---------------------------------------------------------------------
+// PMapGenerator Implementation
+// ---------------------------------------------------------------------
+
+#include "PMapGenerator.h"
+
+#include <vector>
+#include <algorithm>
+
+// Namespace use
+using namespace std;
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Carve Line
+// Precondition: a and b on the grid, in the same row or column
+// Postcondition: Cells from a to b open
+void PMapGenerator::carveLine(PGrid& grid, int ax, int az, int bx, int bz)
+{
+	int dx = (bx > ax) - (bx < ax);
+	int dz = (bz > az) - (bz < az);
+
+	grid.setWall(ax, az, 0);
+
+	while(ax != bx || az != bz)
+	{
+		ax += dx;
+		az += dz;
+		grid.setWall(ax, az, 0);
+	}
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PMapGenerator::PMapGenerator(unsigned int seed)
+{
+	setSeed(seed);
+}
+
+// Deconstructor
+PMapGenerator::~PMapGenerator()
+{
+	// EMPTY
+}
+
+// Set Seed
+void PMapGenerator::setSeed(unsigned int seed)
+{
+	// xorshift never leaves 0
+	this->seed = seed ? seed : 2463534242u;
+}
+
+// Next (xorshift)
+unsigned int PMapGenerator::next()
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return seed;
+}
+
+// Random Fill
+// Precondition: n/a
+// Postcondition: grid resized with about wallPercent of its cells walled
+void PMapGenerator::randomFill(PGrid& grid, int width, int depth, int wallPercent)
+{
+	grid.resize(width, depth);
+
+	for(int z = 0; z < depth; z += 1)
+		for(int x = 0; x < width; x += 1)
+			if((int)(next() % 100) < wallPercent)
+				grid.setWall(x, z, 1);
+}
+
+// Maze
+// Precondition: n/a
+// Postcondition: grid resized and holding a maze (depth first carving,
+// so every passage cell can reach every other)
+void PMapGenerator::maze(PGrid& grid, int width, int depth, int loopPercent)
+{
+	static const int stepX[4] = { 0, 1, 0, -1 };
+	static const int stepZ[4] = { 1, 0, -1, 0 };
+
+	grid.resize(width, depth);
+
+	for(int z = 0; z < depth; z += 1)
+		for(int x = 0; x < width; x += 1)
+			grid.setWall(x, z, 1);
+
+	// Passage cells are the odd ones, the walls between them are knocked
+	// through as the carving visits them
+	int cellsX = width / 2;
+	int cellsZ = depth / 2;
+
+	if(cellsX == 0 || cellsZ == 0)
+		return;
+
+	vector<char> visited(cellsX * cellsZ, 0);
+	vector<int> stack;
+
+	visited[0] = 1;
+	stack.push_back(0);
+	grid.setWall(1, 1, 0);
+
+	while(!stack.empty())
+	{
+		int cell = stack.back();
+		int cx = cell % cellsX;
+		int cz = cell / cellsX;
+
+		// Unvisited neighbours
+		int options[4];
+		int count = 0;
+
+		for(int i = 0; i < 4; i += 1)
+		{
+			int nx = cx + stepX[i];
+			int nz = cz + stepZ[i];
+
+			if(nx >= 0 && nz >= 0 && nx < cellsX && nz < cellsZ && !visited[nz * cellsX + nx])
+			{
+				options[count] = i;
+				count += 1;
+			}
+		}
+
+		if(count == 0)
+		{
+			stack.pop_back();
+			continue;
+		}
+
+		int i = options[range(count)];
+		int nx = cx + stepX[i];
+		int nz = cz + stepZ[i];
+
+		carveLine(grid, cx * 2 + 1, cz * 2 + 1, nx * 2 + 1, nz * 2 + 1);
+
+		visited[nz * cellsX + nx] = 1;
+		stack.push_back(nz * cellsX + nx);
+	}
+
+	// Knock through walls that sit between two passages
+	if(loopPercent <= 0)
+		return;
+
+	for(int z = 1; z < depth - 1; z += 1)
+	{
+		for(int x = 1; x < width - 1; x += 1)
+		{
+			if(!grid.isWall(x, z))
+				continue;
+
+			bool across = !grid.isWall(x - 1, z) && !grid.isWall(x + 1, z) && grid.isWall(x, z - 1) && grid.isWall(x, z + 1);
+			bool down = !grid.isWall(x, z - 1) && !grid.isWall(x, z + 1) && grid.isWall(x - 1, z) && grid.isWall(x + 1, z);
+
+			if((across || down) && range(100) < loopPercent)
+				grid.setWall(x, z, 0);
+		}
+	}
+}
+
+// Rooms
+// Precondition: minSize <= maxSize
+// Postcondition: grid resized and holding rooms joined by corridors
+void PMapGenerator::rooms(PGrid& grid, int width, int depth, int rooms, int minSize, int maxSize)
+{
+	grid.resize(width, depth);
+
+	for(int z = 0; z < depth; z += 1)
+		for(int x = 0; x < width; x += 1)
+			grid.setWall(x, z, 1);
+
+	if(width < 3 || depth < 3 || minSize < 1)
+		return;
+
+	// Rooms as x, z, width, depth, placed where they don't touch
+	// another (give up on a room after a few tries)
+	vector<int> placed;
+
+	for(int r = 0; r < rooms; r += 1)
+	{
+		for(int attempt = 0; attempt < 20; attempt += 1)
+		{
+			int w = min(minSize + range(maxSize - minSize + 1), width - 2);
+			int d = min(minSize + range(maxSize - minSize + 1), depth - 2);
+			int x = 1 + range(width - w - 1);
+			int z = 1 + range(depth - d - 1);
+
+			bool clear = true;
+
+			for(unsigned int i = 0; i < placed.size() && clear; i += 4)
+			{
+				if(x <= placed[i] + placed[i + 2] && placed[i] <= x + w &&
+					z <= placed[i + 1] + placed[i + 3] && placed[i + 1] <= z + d)
+					clear = false;
+			}
+
+			if(!clear)
+				continue;
+
+			for(int j = z; j < z + d; j += 1)
+				carveLine(grid, x, j, x + w - 1, j);
+
+			// Corridor from the last room's centre to this one's
+			int n = placed.size();
+
+			if(n > 0)
+			{
+				int ax = placed[n - 4] + placed[n - 2] / 2;
+				int az = placed[n - 3] + placed[n - 1] / 2;
+				int bx = x + w / 2;
+				int bz = z + d / 2;
+
+				if(range(2))
+				{
+					carveLine(grid, ax, az, bx, az);
+					carveLine(grid, bx, az, bx, bz);
+				}
+				else
+				{
+					carveLine(grid, ax, az, ax, bz);
+					carveLine(grid, ax, bz, bx, bz);
+				}
+			}
+
+			placed.push_back(x);
+			placed.push_back(z);
+			placed.push_back(w);
+			placed.push_back(d);
+			break;
+		}
+	}
+}
+
+// Scatter Sand
+// Precondition: n/a
+// Postcondition: Grains placed, returns how many
+int PMapGenerator::scatterSand(PGrid& grid, int grainsPerColour, int colours)
+{
+	// Never ask for more grains than there is room for
+	int space = 0;
+
+	for(int z = 0; z < grid.getDepth(); z += 1)
+		for(int x = 0; x < grid.getWidth(); x += 1)
+			if(!grid.isWall(x, z) && grid.getSand(x, z) == 0)
+				space += 1;
+
+	int placed = 0;
+
+	for(int colour = 1; colour <= colours; colour += 1)
+	{
+		for(int i = 0; i < grainsPerColour && placed < space; i += 1)
+		{
+			int x, z;
+
+			do
+			{
+				x = range(grid.getWidth());
+				z = range(grid.getDepth());
+			}
+			while(grid.isWall(x, z) || grid.getSand(x, z) != 0);
+
+			grid.setSand(x, z, colour);
+			placed += 1;
+		}
+	}
+
+	return placed;
+}
+
+// Cluster Sand
+// Precondition: n/a
+// Postcondition: Grains placed, returns how many
+int PMapGenerator::clusterSand(PGrid& grid, int grainsPerColour, int colours, int spread)
+{
+	int width = grid.getWidth();
+	int depth = grid.getDepth();
+	int placed = 0;
+
+	if(width == 0 || depth == 0)
+		return 0;
+
+	for(int colour = 1; colour <= colours; colour += 1)
+	{
+		int centreX = range(width);
+		int centreZ = range(depth);
+
+		for(int i = 0; i < grainsPerColour; i += 1)
+		{
+			// Offsets are the difference of two uniform ones, so grains
+			// thin out away from the centre
+			bool done = false;
+
+			for(int attempt = 0; attempt < 64 && !done; attempt += 1)
+			{
+				int x = centreX + range(spread + 1) - range(spread + 1);
+				int z = centreZ + range(spread + 1) - range(spread + 1);
+
+				if(grid.inside(x, z) && !grid.isWall(x, z) && grid.getSand(x, z) == 0)
+				{
+					grid.setSand(x, z, colour);
+					placed += 1;
+					done = true;
+				}
+			}
+
+			// Heap full, take the first free cell after the centre
+			for(int cell = 0; cell < width * depth && !done; cell += 1)
+			{
+				int c = (centreZ * width + centreX + cell) % (width * depth);
+				int x = c % width;
+				int z = c / width;
+
+				if(!grid.isWall(x, z) && grid.getSand(x, z) == 0)
+				{
+					grid.setSand(x, z, colour);
+					placed += 1;
+					done = true;
+				}
+			}
+
+			// No free cell anywhere
+			if(!done)
+				return placed;
+		}
+	}
+
+	return placed;
+}
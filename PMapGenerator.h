@@ -0,0 +1,70 @@
+#pragma once
+#ifndef PMAPGENERATOR
+#define PMAPGENERATOR
+
+// Includes
+#include "PGrid.h"
+
+// ---------------------------------------------------------------------
+// PMapGenerator (Project Map Generator) - Builds maps of any size from
+// a seed. The same seed always gives the same map (it has its own
+// xorshift generator, so rand() and the GP runs don't affect it), so
+// the problems and the benchmarks can be run on the same inputs.
+// ---------------------------------------------------------------------
+
+class PMapGenerator
+{
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	// Generator state (never 0)
+	unsigned int seed;
+
+	// METHODS
+
+	// Random number in [0, n)
+	int range(int n) { return (int)(next() % (unsigned int)n); }
+
+	// Clear a straight run of cells from a to b (inclusive)
+	void carveLine(PGrid& grid, int ax, int az, int bx, int bz);
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	PMapGenerator(unsigned int seed = 2463534242u);
+	~PMapGenerator();
+
+	// Restart the sequence (0 is replaced by the default seed)
+	void setSeed(unsigned int seed);
+
+	// Current state, setSeed with it carries on from here
+	unsigned int getSeed() const { return seed; }
+
+	// Next pseudo random number
+	unsigned int next();
+
+	// Each cell walled with a wallPercent chance
+	void randomFill(PGrid& grid, int width, int depth, int wallPercent);
+
+	// Maze of one cell wide passages on the odd cells, with loopPercent
+	// of the remaining inner walls knocked through to make loops
+	void maze(PGrid& grid, int width, int depth, int loopPercent = 0);
+
+	// Up to rooms rectangular rooms (sides minSize to maxSize), each
+	// joined to the one before by a corridor, everything else walled
+	void rooms(PGrid& grid, int width, int depth, int rooms, int minSize = 3, int maxSize = 8);
+
+	// Scatter grainsPerColour grains of each colour (1 to colours) over
+	// open cells without sand. Returns the number placed (less if the
+	// grid fills up).
+	int scatterSand(PGrid& grid, int grainsPerColour, int colours = 3);
+
+	// As scatterSand, but each colour's grains lie in a heap within
+	// about spread cells of a random centre
+	int clusterSand(PGrid& grid, int grainsPerColour, int colours, int spread);
+};
+
+#endif
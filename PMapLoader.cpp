@@ -0,0 +1,299 @@
+// ---------------------------------------------------------------------
+// PMapLoader Implementation
+// ---------------------------------------------------------------------
+
+#include "PMapLoader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Namespace use
+using namespace std;
+
+// Round a file offset up to the next cache line
+static unsigned long long alignOffset(unsigned long long offset)
+{
+	return (offset + PGrid::CACHE_LINE - 1) & ~(unsigned long long)(PGrid::CACHE_LINE - 1);
+}
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Validate
+// Precondition: header points at the start of the view
+// Postcondition: Returns true if every section lies inside the file
+bool PMapLoader::validate() const
+{
+	if(size < sizeof(PMapHeader) || memcmp(header->magic, PMAP_MAGIC, 4) != 0 || header->version != PMAP_VERSION)
+		return false;
+
+	if(header->width <= 0 || header->depth <= 0)
+		return false;
+
+	unsigned long long width = header->width;
+	unsigned long long depth = header->depth;
+
+	if(header->wallStride < (width + 63) / 64 || (header->sandLayers > 0 && header->sandStride < width))
+		return false;
+
+	// Sections must be aligned for their type and end inside the file.
+	// Each is checked against what's left after its offset by dividing
+	// that down one factor at a time, so neither a huge offset nor a huge
+	// stride or layer count can wrap round
+	unsigned long long left;
+
+	if(header->wallOffset % sizeof(unsigned long long) != 0 || header->wallOffset > size)
+		return false;
+
+	left = size - header->wallOffset;
+
+	if(header->wallStride > left / sizeof(unsigned long long) / depth)
+		return false;
+
+	if(header->sandLayers > 0)
+	{
+		if(header->sandOffset > size)
+			return false;
+
+		left = size - header->sandOffset;
+
+		if(header->sandLayers > left / depth || header->sandStride > left / depth / header->sandLayers)
+			return false;
+	}
+
+	if(header->hasDistance)
+	{
+		if(header->distanceOffset % sizeof(int) != 0 || header->distanceOffset > size)
+			return false;
+
+		left = size - header->distanceOffset;
+
+		if(width > left / sizeof(int) / depth)
+			return false;
+	}
+
+	return header->startX >= 0 && header->startZ >= 0 && header->startX < header->width && header->startZ < header->depth &&
+		header->goalX >= 0 && header->goalZ >= 0 && header->goalX < header->width && header->goalZ < header->depth;
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PMapLoader::PMapLoader()
+{
+	view = NULL;
+	size = 0;
+	file = NULL;
+	mapping = NULL;
+
+	header = NULL;
+	walls = NULL;
+	sand = NULL;
+	distance = NULL;
+}
+
+// Deconstructor
+PMapLoader::~PMapLoader()
+{
+	close();
+}
+
+// Open
+// Precondition: n/a
+// Postcondition: File mapped and its sections found, or nothing open
+bool PMapLoader::open(const char* filename)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if(fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if(!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(PMapHeader))
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if(mappingHandle == NULL)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	view = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if(view == NULL)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	file = fileHandle;
+	mapping = mappingHandle;
+#else
+	int fd = ::open(filename, O_RDONLY);
+
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+
+	if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(PMapHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// The mapping stays valid once the descriptor is closed
+	void* address = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if(address == MAP_FAILED)
+		return false;
+
+	view = (const unsigned char*)address;
+	size = info.st_size;
+#endif
+
+	header = (const PMapHeader*)view;
+
+	if(!validate())
+	{
+		close();
+		return false;
+	}
+
+	walls = (const unsigned long long*)(view + header->wallOffset);
+	sand = header->sandLayers ? view + header->sandOffset : NULL;
+	distance = header->hasDistance ? (const int*)(view + header->distanceOffset) : NULL;
+
+	return true;
+}
+
+// Close
+// Precondition: n/a
+// Postcondition: File unmapped
+void PMapLoader::close()
+{
+	if(view)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+		CloseHandle((HANDLE)mapping);
+		CloseHandle((HANDLE)file);
+#else
+		munmap((void*)view, size);
+#endif
+	}
+
+	view = NULL;
+	size = 0;
+	file = NULL;
+	mapping = NULL;
+
+	header = NULL;
+	walls = NULL;
+	sand = NULL;
+	distance = NULL;
+}
+
+// Load
+// Precondition: Map open
+// Postcondition: grid is the map's size and holds its walls and sand
+void PMapLoader::load(PGrid& grid) const
+{
+	grid.resize(header->width, header->depth);
+	grid.setRows(walls, header->wallStride, sand, header->sandStride);
+}
+
+// Save
+// Precondition: Start and goal on the grid
+// Postcondition: Map file written, returns false if it couldn't be
+bool PMapLoader::save(const char* filename, const PGrid& grid, int startX, int startZ, int goalX, int goalZ, const int* distance)
+{
+	int width = grid.getWidth();
+	int depth = grid.getDepth();
+
+	PMapHeader out;
+	memset(&out, 0, sizeof(out));
+	memcpy(out.magic, PMAP_MAGIC, 4);
+
+	out.version = PMAP_VERSION;
+	out.width = width;
+	out.depth = depth;
+	out.startX = startX;
+	out.startZ = startZ;
+	out.goalX = goalX;
+	out.goalZ = goalZ;
+
+	// Rows keep the grid's cache line padding, so they can be read in
+	// place with the same code as a PGrid
+	out.sandLayers = 1;
+	out.hasDistance = distance != NULL;
+	out.wallStride = grid.getWallStride();
+	out.sandStride = grid.getSandStride();
+
+	out.wallOffset = alignOffset(sizeof(PMapHeader));
+	out.sandOffset = alignOffset(out.wallOffset + (unsigned long long)depth * out.wallStride * sizeof(unsigned long long));
+	out.distanceOffset = alignOffset(out.sandOffset + (unsigned long long)depth * out.sandStride);
+
+	FILE* f = fopen(filename, "wb");
+
+	if(!f)
+		return false;
+
+	bool ok = fwrite(&out, sizeof(out), 1, f) == 1;
+
+	// Pad up to each section
+	vector<char> zero(PGrid::CACHE_LINE, 0);
+	unsigned long long written = sizeof(out);
+
+	ok = ok && fwrite(&zero[0], 1, (size_t)(out.wallOffset - written), f) == out.wallOffset - written;
+
+	for(int z = 0; z < depth && ok; z += 1)
+		ok = fwrite(grid.wallRow(z), sizeof(unsigned long long), out.wallStride, f) == out.wallStride;
+
+	written = out.wallOffset + (unsigned long long)depth * out.wallStride * sizeof(unsigned long long);
+	ok = ok && fwrite(&zero[0], 1, (size_t)(out.sandOffset - written), f) == out.sandOffset - written;
+
+	for(int z = 0; z < depth && ok; z += 1)
+		ok = fwrite(grid.sandRow(z), 1, out.sandStride, f) == out.sandStride;
+
+	if(distance && ok)
+	{
+		written = out.sandOffset + (unsigned long long)depth * out.sandStride;
+		ok = fwrite(&zero[0], 1, (size_t)(out.distanceOffset - written), f) == out.distanceOffset - written;
+		ok = ok && fwrite(distance, sizeof(int), (size_t)width * depth, f) == (size_t)width * depth;
+	}
+
+	// A failed close can lose buffered data too
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok)
+		remove(filename);
+
+	return ok;
+}
@@ -3,24 +3,76 @@
 #define PMAPLOADER
 
 // Include
-#include "PBox.h"
-#include "PGround.h"
-#include <CoreStructures\GUMatrix4.h>
+#include "PGrid.h"
+
+#include <stddef.h>
 
 // ---------------------------------------------------------------------
 // PMapLoader (Project Map Loader) - Used to load map information from files
+//
+// Maps are stored in a binary file that is memory mapped read only, so
+// opening one costs the same whatever its size and the pages are shared
+// by every thread and process that opens it. The file is a PMapHeader
+// followed by the sections it points at, each starting on a cache line:
+// walls (depth rows of wallStride 64 bit words, one bit per cell), sand
+// (sandLayers layers of depth rows of sandStride bytes) and optionally
+// the distance field (one int per cell, moves to the goal or -1).
 // ---------------------------------------------------------------------
 
+// File identifier and format version
+#define PMAP_MAGIC "PMAP"
+#define PMAP_VERSION 1
+
+struct PMapHeader
+{
+	char magic[4];
+	unsigned int version;
+
+	// Dimensions
+	int width;
+	int depth;
+
+	// Start and goal cells
+	int startX;
+	int startZ;
+	int goalX;
+	int goalZ;
+
+	// Sections
+	unsigned int sandLayers;
+	unsigned int hasDistance;
+	unsigned int wallStride;
+	unsigned int sandStride;
+	unsigned long long wallOffset;
+	unsigned long long sandOffset;
+	unsigned long long distanceOffset;
+};
+
 class PMapLoader
 {
 // ---------------------------------------------------------------------
 private:
 
-	// ATTRIBUTES 
+	// ATTRIBUTES
+
+	// Mapped file
+	const unsigned char* view;
+	size_t size;
 
+	// Handles to close (Windows only, the view is all POSIX needs)
+	void* file;
+	void* mapping;
+
+	// Sections of the mapped file
+	const PMapHeader* header;
+	const unsigned long long* walls;
+	const unsigned char* sand;
+	const int* distance;
 
 	// METHODS
 
+	// Check the header describes a file that fits in size bytes
+	bool validate() const;
 
 // ---------------------------------------------------------------------
 public:
@@ -29,7 +81,45 @@ public:
 	PMapLoader();
 	~PMapLoader();
 
+	// Map a file, returns false (leaving nothing open) if it can't be
+	// opened or isn't a valid map
+	bool open(const char* filename);
+
+	// Unmap the file, every pointer from it becomes invalid
+	void close();
+
+	bool isOpen() const { return header != NULL; }
+
+	// Copy the walls and the first sand layer into a grid
+	void load(PGrid& grid) const;
+
+	// Write a grid out as a map file, with its distance field if
+	// distance isn't NULL (width * depth ints)
+	static bool save(const char* filename, const PGrid& grid, int startX, int startZ, int goalX, int goalZ, const int* distance = NULL);
+
+	// Cells (the map must be open and the cell on it)
+	bool isWall(int x, int z) const
+	{ return (walls[(size_t)z * header->wallStride + (x >> 6)] >> (x & 63)) & 1; }
+
+	unsigned char getSand(int x, int z, int layer = 0) const
+	{ return sand[((size_t)layer * header->depth + z) * header->sandStride + x]; }
+
+	int getDistance(int x, int z) const
+	{ return distance[(size_t)z * header->width + x]; }
+
+	// Getters
+	int getWidth() const { return header->width; }
+	int getDepth() const { return header->depth; }
+	int getStartX() const { return header->startX; }
+	int getStartZ() const { return header->startZ; }
+	int getGoalX() const { return header->goalX; }
+	int getGoalZ() const { return header->goalZ; }
+	int getSandLayers() const { return header->sandLayers; }
+	bool hasDistance() const { return distance != NULL; }
 
+	// Direct row access
+	const unsigned long long* wallRow(int z) const { return walls + (size_t)z * header->wallStride; }
+	const int* getDistances() const { return distance; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,108 @@
+// ---------------------------------------------------------------------
+// PScenario Implementation
+// ---------------------------------------------------------------------
+
+#include "PScenario.h"
+
+#include <fstream>
+#include <sstream>
+
+// Namespace use
+using namespace std;
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PScenario::PScenario()
+{
+	// EMPTY
+}
+
+// Deconstructor
+PScenario::~PScenario()
+{
+	// EMPTY
+}
+
+// Load
+// Precondition: n/a
+// Postcondition: Every query in the file stored (lines that don't parse
+// are skipped)
+bool PScenario::load(const char* filename)
+{
+	ifstream in(filename);
+
+	entries.clear();
+
+	if(!in)
+		return false;
+
+	string line;
+
+	while(getline(in, line))
+	{
+		// Skip the version line
+		if(line.compare(0, 7, "version") == 0)
+			continue;
+
+		istringstream fields(line);
+		Entry entry;
+
+		if(fields >> entry.bucket >> entry.map >> entry.width >> entry.depth
+			>> entry.startX >> entry.startZ >> entry.goalX >> entry.goalZ >> entry.optimal)
+			entries.push_back(entry);
+	}
+
+	return true;
+}
+
+// Load Map
+// Precondition: n/a
+// Postcondition: grid holds the map's walls, unchanged if it couldn't be read
+bool PScenario::loadMap(const char* filename, PGrid& grid)
+{
+	ifstream in(filename);
+
+	if(!in)
+		return false;
+
+	// Header lines, up to "map"
+	int width = 0, depth = 0;
+	string key;
+
+	while(in >> key && key != "map")
+	{
+		if(key == "height")
+			in >> depth;
+		else if(key == "width")
+			in >> width;
+		else
+			in >> key; // type
+	}
+
+	if(!in || width <= 0 || depth <= 0)
+		return false;
+
+	PGrid map(width, depth);
+	string row;
+
+	for(int z = 0; z < depth; z += 1)
+	{
+		if(!(in >> row) || (int)row.size() < width)
+			return false;
+
+		for(int x = 0; x < width; x += 1)
+		{
+			char c = row[x];
+
+			if(c != '.' && c != 'G' && c != 'S')
+				map.setWall(x, z, 1);
+		}
+	}
+
+	grid = map;
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef PSCENARIO
+#define PSCENARIO
+
+// Includes
+#include "PGrid.h"
+
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------
+// PScenario (Project Scenario) - Reads the grid pathfinding benchmark
+// text formats: a .map file (header then one character per cell) and
+// its .scen file (one start/goal query per line, grouped in buckets by
+// path length, with the optimal length for 8-connected movement).
+// ---------------------------------------------------------------------
+
+class PScenario
+{
+// ---------------------------------------------------------------------
+public:
+
+	// One query
+	struct Entry
+	{
+		int bucket;
+		std::string map;
+		int width;
+		int depth;
+		int startX;
+		int startZ;
+		int goalX;
+		int goalZ;
+		double optimal;
+	};
+
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	std::vector<Entry> entries;
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	PScenario();
+	~PScenario();
+
+	// Read a .scen file, returns false if it can't be read
+	bool load(const char* filename);
+
+	// Queries
+	int getCount() const { return (int)entries.size(); }
+	const Entry& getEntry(int i) const { return entries[i]; }
+
+	// Read a .map file into a grid. '.', 'G' and 'S' are open, every
+	// other terrain is a wall. Returns false if it can't be read.
+	static bool loadMap(const char* filename, PGrid& grid);
+};
+
+#endif
@@ -0,0 +1,372 @@
+// ---------------------------------------------------------------------
+// PWavefront Implementation
+// ---------------------------------------------------------------------
+
+#include "PWavefront.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Words a step handles at once
+#ifdef __AVX2__
+#define BLOCK_WORDS 4
+#else
+#define BLOCK_WORDS 1
+#endif
+
+// Namespace use
+using namespace std;
+
+// Index of the lowest set bit (bits must not be 0)
+static inline int lowestBit(unsigned long long bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#elif defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	int index = 0;
+
+	while(!(bits & 1))
+	{
+		bits >>= 1;
+		index += 1;
+	}
+
+	return index;
+#endif
+}
+
+// Expand Block
+// One step of the search on the block of words at v (visited), f
+// (front) and n (next). A cell is reached if it's unvisited and beside
+// a cell the last step found: shifting the front left and right by one
+// bit (carrying between words) finds the cells beside it in the row,
+// and the rows above and below, stride words away, are just read. New
+// cells are marked visited and in next, and given distance steps if
+// distance (the block's first cell) isn't NULL. Returns bit 0 set if
+// there were any, bit 1 if one is on the block's left edge and bit 2 if
+// one is on its right edge.
+//
+// The front is only written where a block is expanded, so it can still
+// hold cells from earlier steps, but their neighbours are all visited
+// already so they reach nothing. The block is written back whether or
+// not it gained cells, as testing costs more than the store.
+static inline int expandBlock(const unsigned long long* f, unsigned long long* v, unsigned long long* n, int stride, int* distance, int steps)
+{
+#ifdef __AVX2__
+	__m256i last = _mm256_loadu_si256((const __m256i*)f);
+	__m256i left = _mm256_loadu_si256((const __m256i*)(f - 1));
+	__m256i right = _mm256_loadu_si256((const __m256i*)(f + 1));
+
+	__m256i beside = _mm256_or_si256(
+		_mm256_or_si256(_mm256_slli_epi64(last, 1), _mm256_srli_epi64(left, 63)),
+		_mm256_or_si256(_mm256_srli_epi64(last, 1), _mm256_slli_epi64(right, 63)));
+
+	__m256i reached = _mm256_or_si256(beside, _mm256_or_si256(
+		_mm256_loadu_si256((const __m256i*)(f - stride)),
+		_mm256_loadu_si256((const __m256i*)(f + stride))));
+
+	__m256i seen = _mm256_loadu_si256((const __m256i*)v);
+	__m256i cells = _mm256_andnot_si256(seen, reached);
+
+	_mm256_storeu_si256((__m256i*)v, _mm256_or_si256(seen, cells));
+	_mm256_storeu_si256((__m256i*)n, cells);
+
+	if(_mm256_testz_si256(cells, cells))
+		return 0;
+
+	unsigned long long fresh[4];
+	_mm256_storeu_si256((__m256i*)fresh, cells);
+
+	// Write the distance of each new cell
+	if(distance)
+	{
+		for(int i = 0; i < 4; i += 1)
+		{
+			for(unsigned long long bits = fresh[i]; bits; bits &= bits - 1)
+				distance[(i << 6) + lowestBit(bits)] = steps;
+		}
+	}
+
+	return 1 | (int)(fresh[0] & 1) << 1 | (int)(fresh[3] >> 63) << 2;
+#else
+	unsigned long long beside = (f[0] << 1) | (f[-1] >> 63) | (f[0] >> 1) | (f[1] << 63);
+	unsigned long long cells = (beside | f[-stride] | f[stride]) & ~v[0];
+
+	v[0] |= cells;
+	n[0] = cells;
+
+	// Write the distance of each new cell
+	if(distance)
+	{
+		for(unsigned long long bits = cells; bits; bits &= bits - 1)
+			distance[lowestBit(bits)] = steps;
+	}
+
+	return (cells != 0) | (int)(cells & 1) << 1 | (int)(cells >> 63) << 2;
+#endif
+}
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Prepare
+// Precondition: n/a
+// Postcondition: Bitmaps sized for grid, walls (and the bits past the
+// last column) marked visited so the search never enters them
+void PWavefront::prepare(const PGrid& grid)
+{
+	width = grid.getWidth();
+	depth = grid.getDepth();
+
+	int words = (width + 63) / 64;
+
+	rowWords = ((words + BLOCK_WORDS - 1) / BLOCK_WORDS) * BLOCK_WORDS;
+	stride = rowWords + 2;
+
+	blocks = rowWords / BLOCK_WORDS;
+	blockStride = (blocks + 63) / 64 + 2;
+	lastBlocks = (blocks & 63) ? (1ull << (blocks & 63)) - 1 : ~0ull;
+
+	int size = (depth + 2) * stride;
+
+	visited.assign(size, ~0ull);
+	front.assign(size, 0);
+	next.assign(size, 0);
+	grew.assign((depth + 2) * blockStride, 0);
+	grewNext.assign((depth + 2) * blockStride, 0);
+
+	unsigned long long lastMask = (width & 63) ? (1ull << (width & 63)) - 1 : ~0ull;
+
+	for(int z = 0; z < depth; z += 1)
+	{
+		const unsigned long long* walls = grid.wallRow(z);
+		unsigned long long* row = &visited[(z + 1) * stride + 1];
+
+		for(int w = 0; w < words; w += 1)
+			row[w] = walls[w];
+
+		row[words - 1] |= ~lastMask;
+	}
+}
+
+// Expand Row
+// A block can only gain cells if the last step found cells in it, in
+// the same block of the rows above and below, or on the edge of a block
+// beside it, so only those are expanded. The strides are copied to
+// locals, as the compiler can't tell the stores to the bitmaps don't
+// change the members and would read them again for every block.
+bool PWavefront::expandRow(int z, int* distance, int steps)
+{
+	int rowStride = stride;
+	int maskStride = blockStride;
+	int masks = maskStride - 2;
+
+	const unsigned long long* g = &grew[(z + 1) * maskStride + 1];
+	unsigned long long* gNext = &grewNext[(z + 1) * maskStride + 1];
+
+	const unsigned long long* f = &front[0];
+	unsigned long long* v = &visited[0];
+	unsigned long long* n = &next[0];
+	int start = (z + 1) * rowStride + 1;
+	int* rowDistance = distance ? distance + z * width : NULL;
+
+	unsigned long long any = 0;
+
+	for(int m = 0; m < masks; m += 1)
+	{
+		unsigned long long near = g[m] | g[m - maskStride] | g[m + maskStride];
+
+		if(!near)
+			continue;
+
+		// Blocks that gained cells, and that did on their left and
+		// right edges
+		unsigned long long grown = 0;
+		unsigned long long leftEdge = 0;
+		unsigned long long rightEdge = 0;
+
+		do
+		{
+			int bit = lowestBit(near);
+			int word = ((m << 6) + bit) * BLOCK_WORDS;
+			int index = start + word;
+			int found = expandBlock(f + index, v + index, n + index, rowStride, rowDistance ? rowDistance + (word << 6) : NULL, steps);
+
+			grown |= (unsigned long long)(found & 1) << bit;
+			leftEdge |= (unsigned long long)((found >> 1) & 1) << bit;
+			rightEdge |= (unsigned long long)(found >> 2) << bit;
+
+			near &= near - 1;
+		}
+		while(near);
+
+		// The blocks cells spilled towards are expanded next step along
+		// with the ones that grew (carries into the guard words at the
+		// ends of the row are never read)
+		gNext[m] |= grown | (leftEdge >> 1) | (rightEdge << 1);
+		gNext[m - 1] |= leftEdge << 63;
+		gNext[m + 1] |= rightEdge >> 63;
+		any |= grown;
+	}
+
+	// No block past the end of the row
+	gNext[masks - 1] &= lastBlocks;
+
+	return any != 0;
+}
+
+// Clear Grew
+// Precondition: -1 <= z <= depth
+// Postcondition: Row z's bits in grew all clear
+void PWavefront::clearGrew(int z)
+{
+	unsigned long long* g = &grew[(z + 1) * blockStride + 1];
+	int masks = blockStride - 2;
+
+	// Most rows have a single word, which is stored directly: compilers
+	// turn the loop into a call to memset, which costs more than the
+	// rest of a row's step
+	g[0] = 0;
+
+	for(int m = 1; m < masks; m += 1)
+		g[m] = 0;
+}
+
+// Search
+// Precondition: x/z open
+// Postcondition: See header
+int PWavefront::search(const PGrid& grid, int x, int z, int* distance, int goalX, int goalZ)
+{
+	prepare(grid);
+
+	visited[wordIndex(x, z)] |= 1ull << (x & 63);
+	front[wordIndex(x, z)] = 1ull << (x & 63);
+
+	// The start's block and the ones beside it are expanded first
+	unsigned long long* g = &grew[(z + 1) * blockStride + 1];
+	int block = (x >> 6) / BLOCK_WORDS;
+
+	for(int b = (block > 0) ? block - 1 : 0; b <= block + 1 && b < blocks; b += 1)
+		g[b >> 6] |= 1ull << (b & 63);
+
+	if(distance)
+		distance[z * width + x] = 0;
+
+	bool stopAtGoal = goalX >= 0 && goalZ >= 0 && goalX < width && goalZ < depth;
+	int goalWord = stopAtGoal ? wordIndex(goalX, goalZ) : 0;
+	unsigned long long goalBit = stopAtGoal ? 1ull << (goalX & 63) : 0;
+
+	// Rows that grew last step
+	int lo = z;
+	int hi = z;
+	int steps = 0;
+
+	while(lo <= hi)
+	{
+		if(stopAtGoal && (visited[goalWord] & goalBit))
+			break;
+
+		steps += 1;
+
+		// Only rows beside one that grew can grow
+		int first = (lo > 0) ? lo - 1 : 0;
+		int last = (hi < depth - 1) ? hi + 1 : depth - 1;
+		int newLo = depth;
+		int newHi = -1;
+
+		for(int row = first; row <= last; row += 1)
+		{
+			if(expandRow(row, distance, steps))
+			{
+				if(row < newLo)
+					newLo = row;
+
+				newHi = row;
+			}
+
+			// The blocks of the row above aren't needed again this step
+			clearGrew(row - 1);
+		}
+
+		clearGrew(last);
+
+		front.swap(next);
+		grew.swap(grewNext);
+		lo = newLo;
+		hi = newHi;
+	}
+
+	// The last step found nothing new
+	return (lo > hi) ? steps - 1 : steps;
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PWavefront::PWavefront()
+{
+	rowWords = 0;
+	stride = 0;
+	width = 0;
+	depth = 0;
+	blocks = 0;
+	blockStride = 0;
+	lastBlocks = 0;
+}
+
+// Deconstructor
+PWavefront::~PWavefront()
+{
+	// EMPTY
+}
+
+// Distances
+// Precondition: n/a
+// Postcondition: distance holds every cell's distance to x/z
+int PWavefront::distances(const PGrid& grid, int x, int z, vector<int>& distance)
+{
+	distance.assign(grid.getWidth() * grid.getDepth(), -1);
+
+	if(grid.isBlocked(x, z))
+		return 0;
+
+	return search(grid, x, z, &distance[0], -1, -1);
+}
+
+// Reachable
+// Precondition: n/a
+// Postcondition: Returns true if there's a path between the cells
+bool PWavefront::reachable(const PGrid& grid, int fromX, int fromZ, int toX, int toZ)
+{
+	if(grid.isBlocked(fromX, fromZ) || grid.isBlocked(toX, toZ))
+		return false;
+
+	search(grid, fromX, fromZ, NULL, toX, toZ);
+
+	return (visited[wordIndex(toX, toZ)] >> (toX & 63)) & 1;
+}
+
+// Using AVX2
+bool PWavefront::usingAVX2()
+{
+#ifdef __AVX2__
+	return true;
+#else
+	return false;
+#endif
+}
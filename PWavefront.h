@@ -0,0 +1,89 @@
+#pragma once
+#ifndef PWAVEFRONT
+#define PWAVEFRONT
+
+// Includes
+#include "PGrid.h"
+
+#include <vector>
+
+// ---------------------------------------------------------------------
+// PWavefront (Project Wavefront) - Breadth first search over a PGrid's
+// wall bits. The cells reached so far are a bitmap, so one step of the
+// search grows it 64 cells (or 256 with AVX2) at a time with shifts and
+// masks instead of visiting cells one by one. Each step only looks at
+// the blocks of words beside the cells the last step found, so a step
+// costs about the size of the frontier rather than of the grid.
+// ---------------------------------------------------------------------
+
+class PWavefront
+{
+// ---------------------------------------------------------------------
+private:
+
+	// ATTRIBUTES
+
+	// Words per row of the bitmaps (a multiple of 4 with AVX2), and the
+	// stride between rows (one guard word at each end of a row)
+	int rowWords;
+	int stride;
+	int width;
+	int depth;
+
+	// Bitmaps, with a guard row above and below the grid. Walls and
+	// guards start visited. front holds the cells the last step found
+	// and next those this one finds.
+	std::vector<unsigned long long> visited;
+	std::vector<unsigned long long> front;
+	std::vector<unsigned long long> next;
+
+	// Blocks (of the words a step handles at once) per row, and for each
+	// row a bit per block that gained cells in the last step and in this
+	// one. Laid out like the bitmaps, with guard rows and words. lastBlocks
+	// masks the blocks in the last word of a row.
+	int blocks;
+	int blockStride;
+	unsigned long long lastBlocks;
+	std::vector<unsigned long long> grew;
+	std::vector<unsigned long long> grewNext;
+
+	// METHODS
+
+	// Size the bitmaps for the grid and mark its walls visited
+	void prepare(const PGrid& grid);
+
+	// Index of a cell's word
+	int wordIndex(int x, int z) const
+	{ return (z + 1) * stride + 1 + (x >> 6); }
+
+	// One step of the search on the blocks of row z beside the last
+	// step's cells, returns true if any gained cells
+	bool expandRow(int z, int* distance, int steps);
+
+	// Clear row z's bits of the blocks that grew last step
+	void clearGrew(int z);
+
+	// Run the search from x/z. Writes distances if distance isn't NULL,
+	// stops early once goalX/goalZ is reached if it's on the grid.
+	// Returns the number of steps taken.
+	int search(const PGrid& grid, int x, int z, int* distance, int goalX, int goalZ);
+
+// ---------------------------------------------------------------------
+public:
+
+	// Constructor/Deconstructor
+	PWavefront();
+	~PWavefront();
+
+	// Distance from every cell to x/z (-1 if unreachable), the same
+	// table as PFlowField builds. Returns the largest distance.
+	int distances(const PGrid& grid, int x, int z, std::vector<int>& distance);
+
+	// Can fromX/fromZ reach toX/toZ?
+	bool reachable(const PGrid& grid, int fromX, int fromZ, int toX, int toZ);
+
+	// Was this built with the AVX2 version?
+	static bool usingAVX2();
+};
+
+#endif
@@ -0,0 +1,226 @@
+// ---------------------------------------------------------------------
+// PathBatch Implementation
+// ---------------------------------------------------------------------
+
+#include "PathBatch.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Namespace use
+using namespace std;
+using namespace CoreStructures;
+
+// ---------------------------------------------------------------------
+// PRIVATE
+// ---------------------------------------------------------------------
+
+// Work
+// Wait for a batch, help search it, repeat until stopped
+void PathBatch::work()
+{
+	Pathfinding pf;
+	unsigned int seen = 0;
+	unsigned int version = 0;
+	Pathfinding::SearchMode searchMode = Pathfinding::SEARCH_ASTAR;
+
+	while(true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+
+			while(!stopping && batch == seen)
+				wake.wait(guard);
+
+			if(stopping)
+				return;
+
+			seen = batch;
+		}
+
+		// The map or search may have changed since the last batch
+		if(version != mapVersion || searchMode != mode)
+		{
+			version = mapVersion;
+			searchMode = mode;
+
+			pf.setMapSize(width, depth);
+			pf.attachMapCheck(isCellBlocked);
+			pf.setSearchMode(searchMode);
+
+			if(searchMode == Pathfinding::SEARCH_JPS_PLUS)
+				pf.Preprocess();
+		}
+
+		search(pf);
+
+		{
+			lock_guard<mutex> guard(lock);
+
+			running -= 1;
+
+			if(running == 0)
+				done.notify_all();
+		}
+	}
+}
+
+// Search
+void PathBatch::search(Pathfinding& pf)
+{
+	int u;
+
+	while((u = next++) < (int)distinct.size())
+	{
+		const Query& q = (*queries)[distinct[u]];
+		vector<int>& path = found[u];
+
+		pf.FindPath(GUVector4(q.startX, 0, q.startZ), GUVector4(q.goalX, 0, q.goalZ));
+
+		path.clear();
+
+		// The search's path is already cell indices, start first
+		if(pf.endFound)
+			path.assign(pf.getPath(), pf.getPath() + pf.getPathLength() + 1);
+	}
+}
+
+// ---------------------------------------------------------------------
+// PUBLIC
+// ---------------------------------------------------------------------
+
+// Constructor
+PathBatch::PathBatch(int threads)
+{
+	isCellBlocked = NULL;
+	width = WORLD_SIZE;
+	depth = WORLD_SIZE;
+	mode = Pathfinding::SEARCH_ASTAR;
+	mapVersion = 1;
+
+	batch = 0;
+	running = 0;
+	stopping = false;
+	queries = NULL;
+	next = 0;
+	seconds = 0;
+
+	if(threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+
+	for(int i = 0; i < threads; i += 1)
+		workers.push_back(thread(&PathBatch::work, this));
+}
+
+// Deconstructor
+PathBatch::~PathBatch()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for(unsigned int i = 0; i < workers.size(); i += 1)
+		workers[i].join();
+}
+
+// Set map
+// Precondition: No batch running
+// Postcondition: Workers search this map from the next batch on
+void PathBatch::setMap(checkMap func, int width, int depth)
+{
+	isCellBlocked = func;
+	this->width = width;
+	this->depth = depth;
+
+	mapVersion += 1;
+}
+
+// Run
+// Precondition: Map set
+// Postcondition: Path of every query stored
+void PathBatch::run(const vector<Query>& queries)
+{
+	chrono::high_resolution_clock::time_point begin = chrono::high_resolution_clock::now();
+
+	int count = queries.size();
+	this->queries = &queries;
+
+	// Find the distinct pairs (sort by cells, the first of each run of
+	// equal pairs is searched for the rest)
+	vector< pair<long long, int> > keys(count);
+
+	for(int i = 0; i < count; i += 1)
+	{
+		const Query& q = queries[i];
+		long long start = (long long)q.startZ * width + q.startX;
+		long long goal = (long long)q.goalZ * width + q.goalX;
+
+		keys[i] = make_pair(start * width * depth + goal, i);
+	}
+
+	sort(keys.begin(), keys.end());
+
+	distinct.clear();
+	distinctOf.assign(count, 0);
+
+	for(int i = 0; i < count; i += 1)
+	{
+		if(i == 0 || keys[i].first != keys[i - 1].first)
+			distinct.push_back(keys[i].second);
+
+		distinctOf[keys[i].second] = distinct.size() - 1;
+	}
+
+	found.resize(distinct.size());
+	next = 0;
+
+	// Start the workers and wait for them all to finish
+	{
+		unique_lock<mutex> guard(lock);
+
+		running = workers.size();
+		batch += 1;
+		wake.notify_all();
+
+		while(running > 0)
+			done.wait(guard);
+	}
+
+	// Pack the paths, repeated queries share their first one's cells
+	cells.clear();
+	offset.assign(count, 0);
+	length.assign(count, -1);
+
+	vector<int> packed(distinct.size(), -1);
+
+	for(int i = 0; i < count; i += 1)
+	{
+		int u = distinctOf[i];
+
+		if(packed[u] < 0)
+		{
+			packed[u] = cells.size();
+			cells.insert(cells.end(), found[u].begin(), found[u].end());
+		}
+
+		offset[i] = packed[u];
+		length[i] = (int)found[u].size() - 1;
+	}
+
+	// getPath must always have somewhere to point
+	if(cells.empty())
+		cells.push_back(-1);
+
+	this->queries = NULL;
+
+	seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - begin).count();
+}
+
+// Queries Per Second (for the last batch)
+double PathBatch::getQueriesPerSecond() const
+{
+	return (seconds > 0) ? (double)offset.size() / seconds : 0.0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef PATHBATCH
+#define PATHBATCH
+
+// Includes
+#include "Pathfinding.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// ---------------------------------------------------------------------
+// PathBatch - Answers many path queries at once on a pool of worker
+// threads. Each worker has its own Pathfinding (so its own search
+// scratch), queries asked more than once are only searched once, and
+// the paths come back packed into one array of cell indices.
+// ---------------------------------------------------------------------
+
+class PathBatch
+{
+public:
+
+	// One query, from start to goal
+	struct Query
+	{
+		int startX;
+		int startZ;
+		int goalX;
+		int goalZ;
+	};
+
+private:
+
+	// ATTRIBUTES
+
+	// Map (the checker must be safe to call from several threads at
+	// once, which a read only lookup is)
+	checkMap isCellBlocked;
+	int width;
+	int depth;
+	Pathfinding::SearchMode mode;
+
+	// Bumped by setMap, so workers know to reset their search
+	unsigned int mapVersion;
+
+	// Workers, and the signal that a batch is ready or they should stop
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned int batch;
+	int running;
+	bool stopping;
+
+	// Current batch, each worker takes the next unsearched query
+	const std::vector<Query>* queries;
+	std::vector<int> distinct; // index of first query of each distinct pair
+	std::vector<int> distinctOf; // distinct pair of each query
+	std::vector< std::vector<int> > found; // path of each distinct pair
+	std::atomic<int> next;
+
+	// Results, the path of query i is cells[offset[i]] onwards
+	std::vector<int> cells;
+	std::vector<int> offset;
+	std::vector<int> length;
+
+	// Statistics for the last batch
+	double seconds;
+
+	// METHODS
+
+	// Worker thread
+	void work();
+
+	// Search the distinct pairs until there are none left
+	void search(Pathfinding& pf);
+
+public:
+
+	// METHODS
+
+	// Constructor/Deconstructor (0 threads == one per core)
+	PathBatch(int threads = 0);
+	~PathBatch();
+
+	// Attach checker function and map size (call again if the map
+	// changes, so the workers rebuild anything they keep for it)
+	void setMap(checkMap func, int width, int depth);
+
+	// Search used by every worker
+	void setSearchMode(Pathfinding::SearchMode mode) { this->mode = mode; }
+
+	// Answer every query (returns once they're all answered)
+	void run(const std::vector<Query>& queries);
+
+	// Path of query i, cell indices (z * width + x) from start to goal,
+	// length moves long (-1 if there's no path)
+	const int* getPath(int i) const { return &cells[0] + offset[i]; }
+	int getPathLength(int i) const { return length[i]; }
+
+	// Statistics for the last batch
+	int getThreads() const { return (int)workers.size(); }
+	int getDistinct() const { return (int)distinct.size(); }
+	double getSeconds() const { return seconds; }
+	double getQueriesPerSecond() const;
+};
+
+#endif
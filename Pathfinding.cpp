@@ -6,156 +6,562 @@
 #include "Pathfinding.h"
 
 #include <iostream>
+#include <algorithm>
+#include <stdlib.h>
 
 // Namespace use
 using namespace std;
 using namespace CoreStructures;
 
+// Cost of a node that hasn't been reached yet
+#define UNREACHED 1.0e30f
+
+// Nearest goal searches with more goals than this use the box round
+// the goals as their heuristic
+#define NEAREST_EXACT_GOALS 16
+
 // ---------------------------------------------------------------------
 // PRIVATE
 // ---------------------------------------------------------------------
 
-// Set start and end nodes
-void Pathfinding::SetStartAndEnd(Node startNode, Node endNode)
+// Get the pooled node for a cell, resetting it if it was last
+// used by an earlier search
+Node* Pathfinding::GetNode(int x, int z)
 {
-	//Create start and end cells
-	start = new Node( startNode.x, startNode.z, NULL);
-	end = new Node( endNode.x, endNode.z, &endNode );
+	return PoolNode(nodes, x, z);
+}
 
-	start->G = NULL; // we havent moved so this is 0
-	start->H = start->EuclidianDistance( end ); // set the hueristic to the end goal
-	start->parent = NULL; // just started, has no parent
+// Pool Node
+// GetNode for either direction's pool
+Node* Pathfinding::PoolNode(vector<Node>& pool, int x, int z)
+{
+	// z * ( number of cell in a row ) + x - gives a sequential block number for the grid
+	int id = z * width + x;
+	Node* node = &pool[id];
 
-	// place the start node on the open list ready for inquiry
-	open.push_back(start);
+	if(node->search != search)
+	{
+		node->x = x;
+		node->z = z;
+		node->ID = id;
+		node->parent = NULL;
+		node->G = UNREACHED;
+		node->H = 0;
+		node->closed = 0;
+		node->search = search;
+	}
+
+	return node;
+}
+
+// Push a node onto the open list heap
+void Pathfinding::PushOpen(Node* node)
+{
+	PushHeap(open, node);
+}
+
+// Push Heap
+void Pathfinding::PushHeap(vector<OpenEntry>& heap, Node* node)
+{
+	OpenEntry entry;
+	entry.F = node->getF();
+	entry.G = node->G;
+	entry.ID = node->ID;
+
+	heap.push_back(entry);
+	push_heap(heap.begin(), heap.end());
 }
 
 // Path Opened
 void Pathfinding::PathOpened(int x, int z, float newCost, Node* parent)
 {
-	// If cell block function is not initialised,
-	// output error
+	// Cells off the map are never opened
+	if(x < 0 || z < 0 || x >= width || z >= depth)
+	{
+		return;
+	}
+
 	if(isCellBlocked(x, z))
 	{
 		return;
 	}
 
-	// z * ( number of cell in a column/row ) + number of x cells - gives a sequential block number for a grid of WORLD_SIZE * WORLD_SIZE
-	int id = z * WORLD_SIZE + x;
+	Node* child = GetNode(x, z);
+
+	// if the cell is already in the visited list, abort
+	if(child->closed)
+	{
+		return;
+	}
+
+	// First time the cell is seen, work out its heuristic
+	if(child->G == UNREACHED)
+	{
+		child->H = Heuristic(child);
+	}
 
-	for( int i = 0; i < closed.size(); i++ )
+	// Only (re)open the cell if this is a cheaper way to it
+	if(newCost < child->G)
 	{
-		// if the cell is already in the visited list, abort
-		if( id == closed[i]->ID )
+		child->G = newCost;
+		child->parent = parent;
+		PushOpen(child);
+	}
+}
+
+// Get the next best node in the path
+Node* Pathfinding::GetNextNode()
+{
+	return PopHeap(nodes, open);
+}
+
+// Pop Heap
+// GetNextNode for either direction
+Node* Pathfinding::PopHeap(vector<Node>& pool, vector<OpenEntry>& heap)
+{
+	while(!heap.empty())
+	{
+		// Take the best entry off the heap
+		pop_heap(heap.begin(), heap.end());
+		OpenEntry entry = heap.back();
+		heap.pop_back();
+
+		Node* nextNode = &pool[entry.ID];
+
+		// Skip entries for cells that have since been closed, or
+		// reopened with a cheaper cost
+		if(nextNode->closed || entry.G != nextNode->G)
 		{
-			return;
+			continue;
 		}
+
+		// add it to the visited(closed) list
+		nextNode->closed = 1;
+
+		return nextNode;
 	}
 
-	// If the cell is not blocked or already in the visited list then continue
-	Node* newChild = new Node(x, z, parent);
-	newChild->G = newCost;
-	newChild->H = parent->EuclidianDistance(end);
+	return NULL;
+}
+
+// Continue path
+void Pathfinding::ContinuePath()
+{
+	Node* currentNode;
 
-	// for all open list cells
-	for( int i = 0; i < open.size(); i++ )
+	while((currentNode = GetNextNode()) != NULL)
 	{
-		if( id == open[i]->ID )
+		if(IsGoal(currentNode))
 		{
-			float newF = newChild->G + newCost + open[i]->H;
+			Node* getPath;
 
-			if( open[i]->getF() > newF )
-			{
-				open[i]->G = newChild->G + newCost;
-				open[i]->parent = newChild;
-			}
-			else // if F is not better
+			// A nearest goal search ends at whichever goal it reached
+			end = currentNode;
+
+			// gets the shortest path to the goal (goal first)
+			for(getPath = end; getPath != NULL; getPath = getPath->parent)
 			{
-				delete newChild;
-				return;
+				path.push_back(getPath->ID);
+
+				if(getPath->parent == NULL)
+				{
+					break;
+				}
+
+				// Jumps skip cells, fill in the straight line back to the parent
+				int dx = (getPath->parent->x > getPath->x) - (getPath->parent->x < getPath->x);
+				int dz = (getPath->parent->z > getPath->z) - (getPath->parent->z < getPath->z);
+				int step = dz * width + dx;
+
+				for(int cell = getPath->ID + step; cell != getPath->parent->ID; cell += step)
+				{
+					path.push_back(cell);
+				}
 			}
+
+			// Start first
+			reverse(path.begin(), path.end());
+
+			endFound = true;
+			current = 0;
+			return;
+		}
+
+		expanded += 1;
+
+		if((mode == SEARCH_JPS || mode == SEARCH_JPS_PLUS) && !multiGoal)
+		{
+			ExpandJumps(currentNode);
+			continue;
 		}
+
+		// South Node
+		PathOpened( currentNode->x, currentNode->z + 1, currentNode->G + 1, currentNode );
+		// East Node
+		PathOpened( currentNode->x + 1, currentNode->z, currentNode->G + 1, currentNode );
+		// North Node
+		PathOpened( currentNode->x, currentNode->z - 1, currentNode->G + 1, currentNode );
+		// West Node
+		PathOpened( currentNode->x - 1, currentNode->z, currentNode->G + 1, currentNode );
 	}
+}
 
-	open.push_back(newChild);
+// Is Blocked (off the map counts as blocked)
+bool Pathfinding::IsBlocked(int x, int z)
+{
+	return x < 0 || z < 0 || x >= width || z >= depth || isCellBlocked(x, z);
 }
 
-// Get the next best node in the path
-Node* Pathfinding::GetNextNode()
+// Is Forced
+// A cell entered moving horizontally (dx) has to be a turning point if
+// a cell beside it can't be reached by turning one cell earlier
+bool Pathfinding::IsForced(int x, int z, int dx)
 {
-	float bestF = 999999.0f; // need a default high value to get next best in path and 'start the ball rolling'
-	int nodeIndex = -1;
-	Node* nextNode = NULL;
+	return (!IsBlocked(x, z + 1) && IsBlocked(x - dx, z + 1)) ||
+		(!IsBlocked(x, z - 1) && IsBlocked(x - dx, z - 1));
+}
 
-	// Find next best cell
-	for( int i = 0; i < open.size(); i ++ )
+// Jump Horizontal
+// Shortest paths are searched in an order that turns vertically as
+// early as possible, so a horizontal run only stops at the goal or at
+// a cell with a forced neighbour
+bool Pathfinding::JumpHorizontal(int x, int z, int dx, int& jumpX)
+{
+	while(true)
 	{
-		if( open[i]->getF() < bestF )
+		x += dx;
+
+		if(IsBlocked(x, z))
+		{
+			return false;
+		}
+
+		if((x == end->x && z == end->z) || IsForced(x, z, dx))
 		{
-			bestF = open[i]->getF();
-			nodeIndex = i;
+			jumpX = x;
+			return true;
 		}
 	}
+}
+
+// Jump Vertical
+// A vertical run can turn either way at every cell, so it stops where
+// a horizontal run from the cell would find a jump point
+bool Pathfinding::JumpVertical(int x, int z, int dz, int& jumpZ)
+{
+	int jumpX;
+
+	while(true)
+	{
+		z += dz;
+
+		if(IsBlocked(x, z))
+		{
+			return false;
+		}
+
+		if((x == end->x && z == end->z) || JumpHorizontal(x, z, 1, jumpX) || JumpHorizontal(x, z, -1, jumpX))
+		{
+			jumpZ = z;
+			return true;
+		}
+	}
+}
+
+// Jump Table (JPS+)
+// The table doesn't know the goal, so a run stops early if the goal is
+// within reach in its column, or (vertical runs) on the goal's row
+bool Pathfinding::JumpTable(int x, int z, int dx, int dz, int& jumpX, int& jumpZ)
+{
+	int dir = (dx > 0) ? 0 : (dx < 0) ? 1 : (dz > 0) ? 2 : 3;
+	int distance = jumps[(z * width + x) * 4 + dir];
+	int reach = (distance > 0) ? distance : -distance;
+
+	int ahead = (dx != 0) ? (end->x - x) * dx : (end->z - z) * dz;
+
+	if(ahead > 0 && ahead <= reach && (dx == 0 || end->z == z))
+	{
+		jumpX = (dx != 0) ? end->x : x;
+		jumpZ = (dx != 0) ? z : end->z;
+		return true;
+	}
 
-	// Update lists for best cell
-	if( nodeIndex >= 0 )
+	if(distance > 0)
 	{
-		nextNode = open[nodeIndex]; // grab the best cell from the above index
-		closed.push_back(nextNode); // add it to the visited(closed) list
-		open.erase(open.begin() + nodeIndex); // remove it from the open list
+		jumpX = x + dx * distance;
+		jumpZ = z + dz * distance;
+		return true;
 	}
 
-	return nextNode;
+	return false;
 }
 
-// Continue path
-void Pathfinding::ContinuePath()
+// Open Jump
+// Open the jump point (if any) from node in direction dx/dz
+void Pathfinding::OpenJump(Node* node, int dx, int dz)
+{
+	int jumpX = node->x;
+	int jumpZ = node->z;
+	bool found;
+
+	if(mode == SEARCH_JPS_PLUS)
+		found = JumpTable(node->x, node->z, dx, dz, jumpX, jumpZ);
+	else if(dx != 0)
+		found = JumpHorizontal(node->x, node->z, dx, jumpX);
+	else
+		found = JumpVertical(node->x, node->z, dz, jumpZ);
+
+	if(found)
+	{
+		int distance = abs(jumpX - node->x) + abs(jumpZ - node->z);
+		PathOpened( jumpX, jumpZ, node->G + distance, node );
+	}
+}
+
+// Expand Jumps
+// Open the jump points in the directions a shortest path through the
+// node could continue in, given the direction it arrived from
+void Pathfinding::ExpandJumps(Node* node)
 {
-	if( open.empty() )
+	int x = node->x;
+	int z = node->z;
+
+	// The start node can go anywhere
+	if(node->parent == NULL)
 	{
+		OpenJump(node, 1, 0);
+		OpenJump(node, -1, 0);
+		OpenJump(node, 0, 1);
+		OpenJump(node, 0, -1);
 		return;
 	}
 
-	Node* currentNode = GetNextNode();
+	int dx = (x > node->parent->x) - (x < node->parent->x);
+	int dz = (z > node->parent->z) - (z < node->parent->z);
+
+	if(dx != 0)
+	{
+		// Carry on, and turn only onto forced neighbours
+		OpenJump(node, dx, 0);
+
+		if(!IsBlocked(x, z + 1) && IsBlocked(x - dx, z + 1))
+			OpenJump(node, 0, 1);
+
+		if(!IsBlocked(x, z - 1) && IsBlocked(x - dx, z - 1))
+			OpenJump(node, 0, -1);
+	}
+	else
+	{
+		// Carry on, or turn either way
+		OpenJump(node, 0, dz);
+		OpenJump(node, 1, 0);
+		OpenJump(node, -1, 0);
+	}
+}
 
-	if(currentNode->ID == end->ID)
+// Top Key
+// Drop stale entries, then return the smallest F (UNREACHED if empty)
+float Pathfinding::TopKey(vector<Node>& pool, vector<OpenEntry>& heap)
+{
+	while(!heap.empty())
 	{
-		end->parent = currentNode->parent;
+		const OpenEntry& top = heap.front();
+		Node* node = &pool[top.ID];
+
+		if(!node->closed && top.G == node->G)
+		{
+			return top.F;
+		}
+
+		pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+	}
 
-		Node* getPath;
+	return UNREACHED;
+}
 
-		// gets the shortest path to the goal
-		for(getPath = end; getPath != NULL; getPath = getPath->parent)
+// Begin Search
+// Clear the previous search, every node is unused after this
+void Pathfinding::BeginSearch()
+{
+	ClearPath();
+	ClearOpenList();
+	ClearClosedList();
+	backOpen.clear();
+
+	// Search number wrapped round, old nodes would look current
+	if(search == 0)
+	{
+		for(unsigned int i = 0; i < nodes.size(); i++)
 		{
-			path.push_back( new GUVector4( getPath->x, 0, getPath->z ) );
+			nodes[i].search = 0;
 		}
 
-		endFound = true;
-		current = path.size() - 1;
-		return;
+		for(unsigned int i = 0; i < backNodes.size(); i++)
+		{
+			backNodes[i].search = 0;
+		}
+
+		goalMark.assign(goalMark.size(), 0);
+
+		search = 1;
 	}
-	else
+
+	expanded = 0;
+	endFound = 0;
+	multiGoal = 0;
+	goalFound = -1;
+}
+
+// Heuristic
+// Manhatten distance to the end, or to the nearest goal. With many
+// goals the distance to the box round them is used instead, which is
+// cheaper and still never overestimates.
+float Pathfinding::Heuristic(Node* node)
+{
+	if(!multiGoal)
 	{
-		// South Node
-		PathOpened( currentNode->x, currentNode->z + 1, currentNode->G + 1, currentNode );
-		// East Node
-		PathOpened( currentNode->x + 1, currentNode->z, currentNode->G + 1, currentNode );
-		// North Node
-		PathOpened( currentNode->x, currentNode->z - 1, currentNode->G + 1, currentNode );
-		// West Node
-		PathOpened( currentNode->x - 1, currentNode->z, currentNode->G + 1, currentNode );
+		return node->manhattenDistance(end);
+	}
+
+	if((int)goalCells.size() > NEAREST_EXACT_GOALS)
+	{
+		int dx = max(0, max(goalMinX - node->x, node->x - goalMaxX));
+		int dz = max(0, max(goalMinZ - node->z, node->z - goalMaxZ));
+
+		return (float)(dx + dz);
+	}
+
+	int best = width + depth;
+
+	for(unsigned int i = 0; i < goalCells.size(); i += 1)
+	{
+		int distance = abs(goalCells[i] % width - node->x) + abs(goalCells[i] / width - node->z);
+		best = min(best, distance);
+	}
 
-		for( int i = 0; i < open.size(); i++ )
+	return (float)best;
+}
+
+// Is Goal
+bool Pathfinding::IsGoal(Node* node)
+{
+	if(multiGoal)
+	{
+		return goalMark[node->ID] == search;
+	}
+
+	return node == end;
+}
+
+// Potential
+// Forward heuristic of the bidirectional search (the backward one is
+// its negative). Half the difference of the distances to each end, so
+// both searches see consistent costs and their keys add up to the
+// length of a path through the cell.
+float Pathfinding::Potential(int x, int z)
+{
+	float toEnd = (float)(abs(x - end->x) + abs(z - end->z));
+	float toStart = (float)(abs(x - start->x) + abs(z - start->z));
+
+	return (toEnd - toStart) * 0.5f;
+}
+
+// Continue Bidirectional
+// Expand the smaller frontier until no path through an unexpanded cell
+// could beat the best meeting point found
+void Pathfinding::ContinueBidirectional()
+{
+	static const int stepX[4] = { 0, 1, 0, -1 };
+	static const int stepZ[4] = { 1, 0, -1, 0 };
+
+	float best = UNREACHED;
+	int meet = -1;
+
+	if(start == end)
+	{
+		best = 0;
+		meet = start->ID;
+	}
+
+	while(true)
+	{
+		float forwardKey = TopKey(nodes, open);
+		float backwardKey = TopKey(backNodes, backOpen);
+
+		if(forwardKey >= UNREACHED || backwardKey >= UNREACHED || forwardKey + backwardKey >= best)
 		{
-			if( currentNode->ID == open[i]->ID )
+			break;
+		}
+
+		bool forward = open.size() <= backOpen.size();
+		vector<Node>& pool = forward ? nodes : backNodes;
+		vector<Node>& other = forward ? backNodes : nodes;
+		float sign = forward ? 1.0f : -1.0f;
+
+		Node* node = PopHeap(pool, forward ? open : backOpen);
+		expanded += 1;
+
+		for(int i = 0; i < 4; i += 1)
+		{
+			int x = node->x + stepX[i];
+			int z = node->z + stepZ[i];
+
+			if(IsBlocked(x, z))
+			{
+				continue;
+			}
+
+			Node* child = PoolNode(pool, x, z);
+
+			if(child->closed)
 			{
-				open.erase( open.begin() + i );
+				continue;
+			}
+
+			if(child->G == UNREACHED)
+			{
+				child->H = sign * Potential(x, z);
+			}
+
+			if(node->G + 1 < child->G)
+			{
+				child->G = node->G + 1;
+				child->parent = node;
+				PushHeap(forward ? open : backOpen, child);
+			}
+
+			// Reached from the other end too, a candidate path
+			Node* seen = &other[child->ID];
+
+			if(seen->search == search && seen->G < UNREACHED && child->G + seen->G < best)
+			{
+				best = child->G + seen->G;
+				meet = child->ID;
 			}
 		}
+	}
+
+	if(meet < 0)
+	{
+		return;
+	}
 
-		// Continue until full path is found
-		ContinuePath();
+	// Start to the meeting cell, then on to the end
+	for(Node* node = &nodes[meet]; node != NULL; node = node->parent)
+	{
+		path.push_back(node->ID);
 	}
+
+	reverse(path.begin(), path.end());
+
+	for(Node* node = backNodes[meet].parent; node != NULL; node = node->parent)
+	{
+		path.push_back(node->ID);
+	}
+
+	endFound = true;
+	current = 0;
 }
 
 // ---------------------------------------------------------------------
@@ -168,99 +574,302 @@ Pathfinding::Pathfinding()
 	startInitComplete = 0;
 	endFound = 0;
 	current = 0;
+	startX = 0;
+	startZ = 0;
+	expanded = 0;
+	search = 0;
+	mode = SEARCH_ASTAR;
+
+	multiGoal = 0;
+	goalMinX = goalMinZ = goalMaxX = goalMaxZ = 0;
+	goalFound = -1;
+
+	start = NULL;
+	end = NULL;
+	isCellBlocked = NULL;
+
+	setMapSize(WORLD_SIZE, WORLD_SIZE);
 }
 
 // Deconstructor
 Pathfinding::~Pathfinding()
 {
-	// EMPTY
+	ClearPath();
 }
 
 // Find Path
 void Pathfinding::FindPath(GUVector4 currentPos, GUVector4 endPos)
 {
-	// if the start and end goal are not initialised
-	if( !startInitComplete )
+	// Clear the previous search
+	BeginSearch();
+
+	int sx = (int)currentPos.x;
+	int sz = (int)currentPos.z;
+	int ex = (int)endPos.x;
+	int ez = (int)endPos.z;
+
+	startX = sx;
+	startZ = sz;
+
+	// Nothing to do if either end is off the map
+	if(sx < 0 || sz < 0 || sx >= width || sz >= depth || ex < 0 || ez < 0 || ex >= width || ez >= depth)
 	{
-		// loop through open list and delete (if any) all items
-		for( int i = 0; i < open.size(); i++ )
+		return;
+	}
+
+	// JPS+ needs a table for this map
+	if(mode == SEARCH_JPS_PLUS && jumps.size() != nodes.size() * 4)
+	{
+		Preprocess();
+	}
+
+	//Create start and end cells
+	end = GetNode(ex, ez);
+	start = GetNode(sx, sz);
+
+	if(mode == SEARCH_BIDIRECTIONAL)
+	{
+		// The end is never reached if it's a wall
+		if(isCellBlocked(ex, ez))
 		{
-			delete open[i];
+			return;
 		}
 
-		// Clear open list
-		open.clear();
-
-		// loop through visited list and delete (if any) all items
-		for( int i = 0; i < closed.size(); i++ )
+		if(backNodes.size() != nodes.size())
 		{
-			delete closed[i];
+			backNodes.assign(nodes.size(), Node());
 		}
 
-		// Clear closed list
-		closed.clear();
+		Node* back = PoolNode(backNodes, ex, ez);
+
+		start->G = 0;
+		start->H = Potential(sx, sz);
+		back->G = 0;
+		back->H = -Potential(ex, ez);
+
+		PushHeap(open, start);
+		PushHeap(backOpen, back);
+
+		startInitComplete = 1;
 
-		// loop through path list and delete (if any) all items
-		for( int i = 0; i < path.size(); i++ )
+		ContinueBidirectional();
+		return;
+	}
+
+	start->G = 0; // we havent moved so this is 0
+	start->H = start->manhattenDistance( end ); // set the hueristic to the end goal
+	start->parent = NULL; // just started, has no parent
+
+	// place the start node on the open list ready for inquiry
+	PushOpen(start);
+
+	// Start initialisation complete
+	startInitComplete = 1;
+
+	// Search until the end is found or the open list runs out
+	ContinuePath();
+}
+
+// Find Path To Nearest
+void Pathfinding::FindPathToNearest(GUVector4 currentPos, const vector<GUVector4>& goals)
+{
+	// Clear the previous search
+	BeginSearch();
+
+	int sx = (int)currentPos.x;
+	int sz = (int)currentPos.z;
+
+	startX = sx;
+	startZ = sz;
+
+	if(sx < 0 || sz < 0 || sx >= width || sz >= depth)
+	{
+		return;
+	}
+
+	if(goalMark.size() != nodes.size())
+	{
+		goalMark.assign(nodes.size(), 0);
+	}
+
+	// Mark the goals on the map (off map, wall and repeated goals are
+	// skipped)
+	goalCells.clear();
+	goalMinX = width;
+	goalMinZ = depth;
+	goalMaxX = -1;
+	goalMaxZ = -1;
+
+	for(unsigned int i = 0; i < goals.size(); i += 1)
+	{
+		int x = (int)goals[i].x;
+		int z = (int)goals[i].z;
+
+		if(x < 0 || z < 0 || x >= width || z >= depth || goalMark[z * width + x] == search || isCellBlocked(x, z))
 		{
-			delete path[i];
+			continue;
 		}
 
-		// Clear path list
-		path.clear();
+		goalMark[z * width + x] = search;
+		goalCells.push_back(z * width + x);
+
+		goalMinX = min(goalMinX, x);
+		goalMinZ = min(goalMinZ, z);
+		goalMaxX = max(goalMaxX, x);
+		goalMaxZ = max(goalMaxZ, z);
+	}
+
+	if(goalCells.empty())
+	{
+		return;
+	}
+
+	multiGoal = 1;
 
-		// Initialise start
-		Node sNode;
-		sNode.x = currentPos.x;
-		sNode.z = currentPos.z;
+	start = GetNode(sx, sz);
+	end = NULL;
 
-		// Initialise goal
-		Node eNode;
-		eNode.x = endPos.x;
-		eNode.z = endPos.z;
+	start->G = 0;
+	start->H = Heuristic(start);
+	start->parent = NULL;
 
-		SetStartAndEnd( sNode, eNode );
+	PushOpen(start);
 
-		// Start initialisation complete
-		startInitComplete = 1;
-	}
-	
-	//If start and end goal are initialised then continue the path
-	if(startInitComplete)
+	startInitComplete = 1;
+
+	ContinuePath();
+
+	// Which goal was reached
+	if(endFound)
 	{
-		ContinuePath();
+		for(unsigned int i = 0; i < goals.size(); i += 1)
+		{
+			if((int)goals[i].z * width + (int)goals[i].x == end->ID)
+			{
+				goalFound = i;
+				break;
+			}
+		}
 	}
 }
 
 // Reset path
 void Pathfinding::ResetPath()
 {
-	current = path.size() - 1;
+	current = 0;
+}
+
+// Clear path
+void Pathfinding::ClearPath()
+{
+	// Keeps the buffer for the next path
+	path.clear();
+	current = 0;
 }
 
 // Next Path Position
 GUVector4 Pathfinding::GetNextPosition()
 {
-	GUVector4 nextPos = GUVector4(19.0, 0.0, 19.0);
+	// No path, stay where the search started
+	GUVector4 nextPos = GUVector4(startX, 0.0, startZ);
 
 	if(path.size())
 	{
-		if(current > 0)
-		{
-			nextPos = GUVector4(path[current]->x, 0, path[current]->z);
-			current -= 1;
-		}
-		else
-			nextPos = GUVector4(path[0]->x, 0, path[0]->z);
+		// Stays on the goal once it's reached
+		int cell = path[current];
+		nextPos = GUVector4(cell % width, 0, cell / width);
+
+		if(current + 1 < (int)path.size())
+			current += 1;
 	}
 
 	return nextPos;
 }
 
+// Memory Used
+size_t Pathfinding::getMemoryUsed() const
+{
+	return (nodes.capacity() + backNodes.capacity()) * sizeof(Node) +
+		(open.capacity() + backOpen.capacity()) * sizeof(OpenEntry) +
+		(path.capacity() + jumps.capacity() + goalCells.capacity()) * sizeof(int) +
+		goalMark.capacity() * sizeof(unsigned int);
+}
+
 // Attach checker function
 void Pathfinding::attachMapCheck(checkMap func)
 {
 	// This function is used to attach a map checker function,
 	// allowing the algorithm to be portable and encapsulated.
 	isCellBlocked = func;
+}
+
+// Set map size
+void Pathfinding::setMapSize(int width, int depth)
+{
+	this->width = width;
+	this->depth = depth;
+
+	// One pooled node per cell, all unused
+	nodes.assign(width * depth, Node());
+	backNodes.clear();
+	goalMark.clear();
+	search = 0;
+
+	// The jump table was for the old map
+	jumps.clear();
+}
+
+// Preprocess
+// Precondition: Map checker attached, map size set
+// Postcondition: JPS+ jump distances stored for every cell/direction
+void Pathfinding::Preprocess()
+{
+	jumps.assign(width * depth * 4, 0);
+
+	// Horizontal runs, filled from the far end of each row so that
+	// every cell builds on its neighbour
+	for(int z = 0; z < depth; z += 1)
+	{
+		for(int i = 0; i < width; i += 1)
+		{
+			int east = width - 1 - i;
+			int west = i;
+
+			if(!IsBlocked(east + 1, z))
+			{
+				int next = jumps[(z * width + east + 1) * 4 + 0];
+				jumps[(z * width + east) * 4 + 0] = IsForced(east + 1, z, 1) ? 1 : (next > 0) ? next + 1 : next - 1;
+			}
+
+			if(!IsBlocked(west - 1, z))
+			{
+				int next = jumps[(z * width + west - 1) * 4 + 1];
+				jumps[(z * width + west) * 4 + 1] = IsForced(west - 1, z, -1) ? 1 : (next > 0) ? next + 1 : next - 1;
+			}
+		}
+	}
+
+	// Vertical runs stop on cells with a horizontal jump point
+	for(int x = 0; x < width; x += 1)
+	{
+		for(int i = 0; i < depth; i += 1)
+		{
+			int south = depth - 1 - i;
+			int north = i;
+
+			if(!IsBlocked(x, south + 1))
+			{
+				int cell = ((south + 1) * width + x) * 4;
+				int next = jumps[cell + 2];
+				jumps[(south * width + x) * 4 + 2] = (jumps[cell] > 0 || jumps[cell + 1] > 0) ? 1 : (next > 0) ? next + 1 : next - 1;
+			}
+
+			if(!IsBlocked(x, north - 1))
+			{
+				int cell = ((north - 1) * width + x) * 4;
+				int next = jumps[cell + 3];
+				jumps[(north * width + x) * 4 + 3] = (jumps[cell] > 0 || jumps[cell + 1] > 0) ? 1 : (next > 0) ? next + 1 : next - 1;
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -11,31 +11,178 @@
 // Typedef for function pointer
 typedef bool (*checkMap)(int x, int z);
 
+// ---------------------------------------------------------------------
+// PathIterator - Steps through a path stored as cell indices
+// (z * width + x), start first. It only points at the cells, so it's
+// cheap to copy and never allocates; it's valid until the path it came
+// from is cleared or searched again.
+// ---------------------------------------------------------------------
+
+class PathIterator
+{
+private:
+
+	const int* cells;
+	int count;
+	int index;
+	int width;
+
+public:
+
+	PathIterator() : cells(0), count(0), index(0), width(1) {}
+	PathIterator(const int* cells, int count, int width) : cells(cells), count(count), index(0), width(width) {}
+
+	// Is there a cell at the iterator (false once past the goal)?
+	bool valid() const { return index < count; }
+
+	// Move on to the next cell
+	void next() { index += 1; }
+
+	// Back to the start of the path
+	void reset() { index = 0; }
+
+	// Current cell
+	int cell() const { return cells[index]; }
+	int x() const { return cells[index] % width; }
+	int z() const { return cells[index] / width; }
+
+	// Cells left, the current one included
+	int remaining() const { return count - index; }
+};
+
 // ---------------------------------------------------------------------
 // Pathfinding - Used to find paths across the map
 // ---------------------------------------------------------------------
 
 class Pathfinding
 {
+public:
+
+	// Search used by FindPath. The jump point searches give the same
+	// path lengths as A* on uniform cost grids but only open the cells
+	// where the path might turn. JPS+ reads the jumps from a table
+	// built by Preprocess, so the map must not change after it.
+	// Bidirectional runs A* out from both ends at once and stops when
+	// the two searches can't find a shorter meeting point.
+	enum SearchMode
+	{
+		SEARCH_ASTAR,
+		SEARCH_JPS,
+		SEARCH_JPS_PLUS,
+		SEARCH_BIDIRECTIONAL
+	};
+
 private:
 
+	// Open list entry, a node and the F it was pushed with.
+	// Entries aren't removed when a node improves, they are
+	// skipped when popped if the node has been closed since.
+	struct OpenEntry
+	{
+		float F;
+		float G;
+		int ID;
+
+		// Order for the heap: smallest F first, then largest G
+		// (prefer nodes nearer the goal when F ties)
+		bool operator<(const OpenEntry& e) const
+		{
+			if(F != e.F)
+				return F > e.F;
+
+			return G < e.G;
+		}
+	};
+
 	// ATTRIBUTES
 	
 	Node *start;
 	Node *end;
-	std::vector<Node*> open;
-	std::vector<Node*> closed;
-	std::vector<CoreStructures::GUVector4*> path;
 
+	// Map dimensions
+	int width;
+	int depth;
+
+	// One pooled node per cell, indexed by Node::ID
+	std::vector<Node> nodes;
+
+	// Open list (binary heap)
+	std::vector<OpenEntry> open;
+
+	// Nodes and open list of the search back from the goal
+	// (bidirectional only, allocated on first use)
+	std::vector<Node> backNodes;
+	std::vector<OpenEntry> backOpen;
+
+	// Goals of a nearest goal search. A cell is a goal if its goalMark
+	// matches the search number.
+	bool multiGoal;
+	std::vector<unsigned int> goalMark;
+	std::vector<int> goalCells;
+	int goalMinX, goalMinZ, goalMaxX, goalMaxZ;
+	int goalFound;
+
+	// Number of the current search (see Node::search)
+	unsigned int search;
+
+	// Last path found, cell indices (z * width + x) from start to goal.
+	// Cleared rather than freed between searches, so it's only
+	// reallocated when a path is longer than any before it.
+	std::vector<int> path;
+
+	// Index of the next cell GetNextPosition returns
 	int current;
 
+	// Cell the last search started from (GetNextPosition stays on it
+	// when there is no path)
+	int startX;
+	int startZ;
+
+	// Nodes expanded by the last search
+	int expanded;
+
+	// Search used by FindPath
+	SearchMode mode;
+
+	// JPS+ jump distances, four per cell (east, west, south, north).
+	// Positive: a jump point is that many cells away.
+	// Zero or negative: no jump point, -distance cells are open.
+	std::vector<int> jumps;
+
 	// METHODS
 
-	void SetStartAndEnd(Node startNode, Node endNode);
+	Node* GetNode(int x, int z);
+	void PushOpen(Node* node);
 	void PathOpened(int x, int z, float newCost, Node* parent);
 	Node* GetNextNode();
 	void ContinuePath();
 
+	// Shared by both directions of the bidirectional search
+	Node* PoolNode(std::vector<Node>& pool, int x, int z);
+	void PushHeap(std::vector<OpenEntry>& heap, Node* node);
+	Node* PopHeap(std::vector<Node>& pool, std::vector<OpenEntry>& heap);
+	float TopKey(std::vector<Node>& pool, std::vector<OpenEntry>& heap);
+
+	// Forget the last search
+	void BeginSearch();
+
+	// Heuristic for a cell, towards the end or the nearest goal
+	float Heuristic(Node* node);
+	bool IsGoal(Node* node);
+
+	// Bidirectional search
+	float Potential(int x, int z);
+	void ContinueBidirectional();
+
+	// Jump point search
+	bool IsBlocked(int x, int z);
+	bool IsForced(int x, int z, int dx);
+	bool JumpHorizontal(int x, int z, int dx, int& jumpX);
+	bool JumpVertical(int x, int z, int dz, int& jumpZ);
+	bool JumpTable(int x, int z, int dx, int dz, int& jumpX, int& jumpZ);
+	void OpenJump(Node* node, int dx, int dz);
+	void ExpandJumps(Node* node);
+
 	// Map Checker function
 	checkMap isCellBlocked;
 
@@ -58,6 +205,13 @@ public:
 	// Find a path from the start to the end
 	void FindPath(CoreStructures::GUVector4 currentPos, CoreStructures::GUVector4 endPos);
 
+	// Find a path to whichever goal is nearest, with one A* search
+	// (whatever the search mode) that stops at the first goal reached
+	void FindPathToNearest(CoreStructures::GUVector4 currentPos, const std::vector<CoreStructures::GUVector4>& goals);
+
+	// Index of the goal the last FindPathToNearest reached (-1 if none)
+	int getGoalFound() { return goalFound; }
+
 	// Return the next path position
 	CoreStructures::GUVector4 GetNextPosition();
 
@@ -66,11 +220,38 @@ public:
 
 	// Clear lists
 	void ClearOpenList() { open.clear(); }
-	void ClearClosedList() { closed.clear(); }
-	void ClearPath() { path.clear(); }
+	void ClearClosedList() { search += 1; }
+	void ClearPath();
 
 	// Attach checker function
 	void attachMapCheck(checkMap func);
+
+	// Set the map dimensions (WORLD_SIZE x WORLD_SIZE by default)
+	void setMapSize(int width, int depth);
+
+	// Nodes expanded by the last search
+	int getExpanded() { return expanded; }
+
+	// Bytes held for searching (the buffers only grow, so this is the
+	// most any search so far has needed)
+	size_t getMemoryUsed() const;
+
+	// Choose the search used by FindPath
+	void setSearchMode(SearchMode mode) { this->mode = mode; }
+	SearchMode getSearchMode() { return mode; }
+
+	// Build the JPS+ jump table, call again whenever the map changes
+	void Preprocess();
+
+	// Length of the last path found (moves, -1 if none)
+	int getPathLength() { return (int)path.size() - 1; }
+
+	// Cells of the last path found, getPathLength() + 1 of them
+	const int* getPath() const { return path.empty() ? 0 : &path[0]; }
+
+	// Iterator over the last path found
+	PathIterator getPathIterator() const
+	{ return PathIterator(getPath(), (int)path.size(), width); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////
+// edit.cpp -- canned editing functions for S-Expressions
+//
+// Written by Jak R. Boulton, 2013
+// University of Glamorgam, Software Engineering
+////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+// Each function is handed a node whose arguments have
+// already been edited (see edit() in sexp.cpp) and returns
+// the node that should replace it.  Nothing is folded
+// unless the code removed is free of side effects, so an
+// edited program always does exactly what the original did.
+////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include "gp.h"
+
+using namespace std;
+
+// Replace s by its argument ind, deleting the rest of s
+static S_Expression *keep_arg (S_Expression *s, int ind)
+{
+	S_Expression *kept = s->args[ind];
+
+	s->args[ind] = NULL;
+	delete s;
+
+	return kept;
+}
+
+// Is the argument free of side effects?
+static int pure (S_Expression *s)
+{
+	return !s->side_effects();
+}
+
+// If s is the same conditional as parent (same function and
+// same condition args), return the branch that parent's
+// outcome would take.  The conditions must be pure so that
+// they give the same answer both times they are evaluated.
+static S_Expression *shortcut (S_Expression *parent, S_Expression *s, int nconds, int branch)
+{
+	if (s->type != STfunction || s->which != parent->which)
+		return s;
+
+	for (int i = 0; i < nconds; ++i)
+		if (!pure (parent->args[i]) || !equiv (parent->args[i], s->args[i]))
+			return s;
+
+	return keep_arg (s, branch);
+}
+
+// (IFLTE a b c d) - if a <= b then c else d
+S_Expression *edit_iflte (S_Expression *s)
+{
+	float a, b;
+
+	// Both conditions are constant: one branch is dead
+	if (s->args[0]->is_numerical (a) && s->args[1]->is_numerical (b))
+		return keep_arg (s, (a <= b) ? 2 : 3);
+
+	// (IFLTE a a c d) is always c
+	if (pure (s->args[0]) && equiv (s->args[0], s->args[1]))
+		return keep_arg (s, 2);
+
+	// Both branches are the same, the test is irrelevant
+	if (pure (s->args[0]) && pure (s->args[1]) && equiv (s->args[2], s->args[3]))
+		return keep_arg (s, 2);
+
+	// A nested test identical to this one is already decided
+	s->args[2] = shortcut (s, s->args[2], 2, 2);
+	s->args[3] = shortcut (s, s->args[3], 2, 3);
+
+	return s;
+}
+
+// (IFLTZ a b c) - if a < 0 then b else c
+S_Expression *edit_ifltz (S_Expression *s)
+{
+	float a;
+
+	// Constant condition: one branch is dead
+	if (s->args[0]->is_numerical (a))
+		return keep_arg (s, (a < 0) ? 1 : 2);
+
+	// Both branches are the same, the test is irrelevant
+	if (pure (s->args[0]) && equiv (s->args[1], s->args[2]))
+		return keep_arg (s, 1);
+
+	// A nested test identical to this one is already decided
+	s->args[1] = shortcut (s, s->args[1], 1, 1);
+	s->args[2] = shortcut (s, s->args[2], 1, 2);
+
+	return s;
+}
@@ -0,0 +1,597 @@
+////////////////////////////////////////////////////////////
+// egraph.cpp -- equality saturation for S-Expressions
+//
+// Written by Jak R. Boulton, 2013
+// University of Glamorgam, Software Engineering
+////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <string.h>
+#include <time.h>
+
+#include "egraph.h"
+
+using namespace std;
+
+// Larger than the cost of any tree we could extract
+#define EGRAPH_INFINITY 0x3fffffff
+
+// Ordering used to hash-cons e-nodes
+bool EGraph::ENode::operator< (const ENode& n) const
+{
+	if (type != n.type)
+		return type < n.type;
+
+	if (which != n.which)
+		return which < n.which;
+
+	if (val != n.val)
+		return val < n.val;
+
+	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
+		if (args[i] != n.args[i])
+			return args[i] < n.args[i];
+
+	return false;
+}
+
+// Look a function up by name without complaining if the
+// current function set doesn't have it
+static int find_function (const char *name)
+{
+	for (int i = 0; i < Fset.n; ++i)
+		if (! strcmp (Fset.getname (i), name))
+			return i;
+
+	return -1;
+}
+
+// Constructor
+EGraph::EGraph (void)
+{
+	max_nodes = 5000;
+	changed = 0;
+
+	fiflte = fifltz = fifdrop = -1;
+	fadd = fsub = fmul = fdiv = -1;
+}
+
+// Return the representative of class c
+int EGraph::find (int c)
+{
+	while (leader[c] != c)
+	{
+		leader[c] = leader[leader[c]];
+		c = leader[c];
+	}
+
+	return c;
+}
+
+// Record that classes a and b are equivalent
+void EGraph::merge (int a, int b)
+{
+	a = find (a);
+	b = find (b);
+
+	if (a == b)
+		return;
+
+	leader[b] = a;
+
+	EClass& ca = eclasses[a];
+	EClass& cb = eclasses[b];
+
+	ca.nodes.insert (ca.nodes.end(), cb.nodes.begin(), cb.nodes.end());
+	cb.nodes.clear();
+
+	if (!ca.is_constant && cb.is_constant)
+	{
+		ca.is_constant = 1;
+		ca.val = cb.val;
+	}
+
+	ca.pure |= cb.pure;
+	changed = 1;
+}
+
+// Add an e-node, returning the class that holds it
+int EGraph::add (ENode n)
+{
+	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
+		if (n.args[i] >= 0)
+			n.args[i] = find (n.args[i]);
+
+	map<ENode, int>::iterator it = memo.find (n);
+
+	if (it != memo.end())
+		return find (it->second);
+
+	EClass c;
+	c.nodes.push_back ((int) enodes.size());
+	c.is_constant = (n.type == STconstant);
+	c.val = n.val;
+	c.pure = (n.type != STfunction);
+
+	enodes.push_back (n);
+	owner.push_back ((int) eclasses.size());
+	eclasses.push_back (c);
+	leader.push_back ((int) leader.size());
+
+	int id = (int) eclasses.size() - 1;
+	memo[n] = id;
+	changed = 1;
+
+	return id;
+}
+
+int EGraph::add_constant (float f)
+{
+	ENode n;
+	n.type = STconstant;
+	n.which = 0;
+	n.val = f;
+
+	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
+		n.args[i] = -1;
+
+	return add (n);
+}
+
+int EGraph::add_sexpression (S_Expression *s)
+{
+	ENode n;
+	n.type = s->type;
+	n.which = (s->type == STconstant) ? 0 : s->which;
+	n.val = (s->type == STconstant) ? s->val : 0;
+
+	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
+		n.args[i] = -1;
+
+	if (s->type == STfunction)
+		for (int i = 0; i < Fset.nargs (s->which); ++i)
+			n.args[i] = add_sexpression (s->args[i]);
+
+	int c = add (n);
+
+	// Terminals named like numbers are constants too
+	float f;
+
+	if (s->type == STterminal && s->is_numerical (f))
+	{
+		eclasses[c].is_constant = 1;
+		eclasses[c].val = f;
+	}
+
+	return c;
+}
+
+// Re-canonicalise every e-node and merge the classes of any
+// two that have become identical (congruence closure)
+int EGraph::rebuild (void)
+{
+	int merged = 0;
+	int again = 1;
+
+	while (again)
+	{
+		again = 0;
+		memo.clear();
+
+		for (int c = 0; c < (int) eclasses.size(); ++c)
+		{
+			if (find (c) != c)
+				continue;
+
+			for (int k = 0; k < (int) eclasses[c].nodes.size(); ++k)
+			{
+				ENode& n = enodes[eclasses[c].nodes[k]];
+
+				for (int i = 0; i < MAX_SEXP_ARGS; ++i)
+					if (n.args[i] >= 0)
+						n.args[i] = find (n.args[i]);
+
+				map<ENode, int>::iterator it = memo.find (n);
+
+				if (it == memo.end())
+					memo[n] = c;
+				else if (find (it->second) != find (c))
+				{
+					merge (it->second, c);
+					again = merged = 1;
+				}
+			}
+		}
+	}
+
+	return merged;
+}
+
+// A class is pure if any of its nodes is a function without
+// side effects whose arguments are all pure
+void EGraph::analyse (void)
+{
+	int again = 1;
+
+	while (again)
+	{
+		again = 0;
+
+		for (int c = 0; c < (int) eclasses.size(); ++c)
+		{
+			if (find (c) != c || eclasses[c].pure)
+				continue;
+
+			for (int k = 0; k < (int) eclasses[c].nodes.size() && !eclasses[c].pure; ++k)
+			{
+				ENode& n = enodes[eclasses[c].nodes[k]];
+				int pure = 1;
+
+				if (n.type == STfunction && Fset.has_sideeffects (n.which))
+					continue;
+
+				if (n.type == STfunction)
+					for (int i = 0; i < Fset.nargs (n.which); ++i)
+						if (!eclasses[find (n.args[i])].pure)
+							pure = 0;
+
+				if (pure)
+					eclasses[c].pure = again = 1;
+			}
+		}
+	}
+}
+
+// Apply the rewrite rules to a single e-node.  The conditions
+// of a test may only be dropped when they are pure, otherwise
+// their side effects would be lost.
+void EGraph::apply_rules (int node)
+{
+	ENode n = enodes[node];
+
+	if (n.type != STfunction)
+		return;
+
+	int self = find (owner[node]);
+
+	int a = n.args[0] >= 0 ? find (n.args[0]) : -1;
+	int b = n.args[1] >= 0 ? find (n.args[1]) : -1;
+	int c = n.args[2] >= 0 ? find (n.args[2]) : -1;
+	int d = n.args[3] >= 0 ? find (n.args[3]) : -1;
+
+	// Copy the facts, add() may move the classes around
+	struct { int is_constant, pure; float val; } A, B;
+	A.is_constant = B.is_constant = A.pure = B.pure = 0;
+	A.val = B.val = 0;
+
+	if (a >= 0)
+	{
+		A.is_constant = eclasses[a].is_constant;
+		A.pure = eclasses[a].pure;
+		A.val = eclasses[a].val;
+	}
+
+	if (b >= 0)
+	{
+		B.is_constant = eclasses[b].is_constant;
+		B.pure = eclasses[b].pure;
+		B.val = eclasses[b].val;
+	}
+
+	if (n.which == fiflte)
+	{
+		// (IFLTE k1 k2 c d) => c or d
+		if (A.is_constant && B.is_constant)
+			merge (self, (A.val <= B.val) ? c : d);
+		// (IFLTE a a c d) => c
+		else if (a == b && A.pure)
+			merge (self, c);
+
+		// (IFLTE a b c c) => c
+		if (c == d && A.pure && B.pure)
+			merge (self, c);
+
+		// (IFLTE a b (IFLTE a b x y) d) => (IFLTE a b x d)
+		if (A.pure && B.pure)
+		{
+			vector<int> inner (eclasses[find (c)].nodes);
+
+			for (int k = 0; k < (int) inner.size(); ++k)
+			{
+				ENode m = enodes[inner[k]];
+
+				if (m.type == STfunction && m.which == fiflte && find (m.args[0]) == a && find (m.args[1]) == b)
+				{
+					ENode r = n;
+					r.args[2] = m.args[2];
+					merge (self, add (r));
+				}
+			}
+
+			inner = eclasses[find (d)].nodes;
+
+			for (int k = 0; k < (int) inner.size(); ++k)
+			{
+				ENode m = enodes[inner[k]];
+
+				if (m.type == STfunction && m.which == fiflte && find (m.args[0]) == a && find (m.args[1]) == b)
+				{
+					ENode r = n;
+					r.args[3] = m.args[3];
+					merge (self, add (r));
+				}
+			}
+		}
+	}
+	else if (n.which == fifltz)
+	{
+		// (IFLTZ k b c) => b or c
+		if (A.is_constant)
+			merge (self, (A.val < 0) ? b : c);
+
+		// (IFLTZ a b b) => b
+		if (b == c && A.pure)
+			merge (self, b);
+
+		// (IFLTZ a (IFLTZ a x y) c) => (IFLTZ a x c)
+		if (A.pure)
+		{
+			vector<int> inner (eclasses[find (b)].nodes);
+
+			for (int k = 0; k < (int) inner.size(); ++k)
+			{
+				ENode m = enodes[inner[k]];
+
+				if (m.type == STfunction && m.which == fifltz && find (m.args[0]) == a)
+				{
+					ENode r = n;
+					r.args[1] = m.args[1];
+					merge (self, add (r));
+				}
+			}
+
+			inner = eclasses[find (c)].nodes;
+
+			for (int k = 0; k < (int) inner.size(); ++k)
+			{
+				ENode m = enodes[inner[k]];
+
+				if (m.type == STfunction && m.which == fifltz && find (m.args[0]) == a)
+				{
+					ENode r = n;
+					r.args[2] = m.args[2];
+					merge (self, add (r));
+				}
+			}
+		}
+	}
+	else if (n.which == fifdrop)
+	{
+		// IF-DROP always attempts its drop before evaluating
+		// either branch, so it has no identities of its own.
+		// Its branches are simplified through their classes.
+	}
+	else if (n.which == fadd)
+	{
+		if (A.is_constant && B.is_constant)
+			merge (self, add_constant (A.val + B.val));
+		else if (B.is_constant && B.val == 0)
+			merge (self, a);
+		else if (A.is_constant && A.val == 0)
+			merge (self, b);
+
+		// (+ a b) => (+ b a), only when swapping them can't
+		// change the order of their side effects
+		if (A.pure && B.pure)
+		{
+			ENode r = n;
+			r.args[0] = b;
+			r.args[1] = a;
+			merge (self, add (r));
+		}
+	}
+	else if (n.which == fsub)
+	{
+		if (A.is_constant && B.is_constant)
+			merge (self, add_constant (A.val - B.val));
+		else if (B.is_constant && B.val == 0)
+			merge (self, a);
+		else if (a == b && A.pure)
+			merge (self, add_constant (0));
+	}
+	else if (n.which == fmul)
+	{
+		if (A.is_constant && B.is_constant)
+			merge (self, add_constant (A.val * B.val));
+		else if (B.is_constant && B.val == 1)
+			merge (self, a);
+		else if (A.is_constant && A.val == 1)
+			merge (self, b);
+		else if ((B.is_constant && B.val == 0 && A.pure) || (A.is_constant && A.val == 0 && B.pure))
+			merge (self, add_constant (0));
+
+		// (* a b) => (* b a), only when swapping them can't
+		// change the order of their side effects
+		if (A.pure && B.pure)
+		{
+			ENode r = n;
+			r.args[0] = b;
+			r.args[1] = a;
+			merge (self, add (r));
+		}
+	}
+	else if (n.which == fdiv)
+	{
+		// Protected division returns 1 when dividing by zero,
+		// so (% a a) is 1 whatever a is
+		if (B.is_constant && B.val == 1)
+			merge (self, a);
+		else if (a == b && A.pure)
+			merge (self, add_constant (1));
+	}
+}
+
+// Compute the size of the smallest tree in every class, and
+// which of the class's e-nodes roots it
+void EGraph::costs (vector<int>& cost, vector<int>& best)
+{
+	cost.assign (eclasses.size(), EGRAPH_INFINITY);
+	best.assign (eclasses.size(), -1);
+
+	int again = 1;
+
+	while (again)
+	{
+		again = 0;
+
+		for (int c = 0; c < (int) eclasses.size(); ++c)
+		{
+			if (find (c) != c)
+				continue;
+
+			for (int k = 0; k < (int) eclasses[c].nodes.size(); ++k)
+			{
+				ENode& n = enodes[eclasses[c].nodes[k]];
+				int total = 1;
+
+				if (n.type == STfunction)
+					for (int i = 0; i < Fset.nargs (n.which) && total < EGRAPH_INFINITY; ++i)
+						total += cost[find (n.args[i])];
+
+				if (total < cost[c])
+				{
+					cost[c] = total;
+					best[c] = eclasses[c].nodes[k];
+					again = 1;
+				}
+			}
+		}
+	}
+}
+
+// Build the cheapest tree for class c
+S_Expression *EGraph::extract (int c, vector<int>& best)
+{
+	ENode& n = enodes[best[find (c)]];
+	S_Expression *s = new S_Expression;
+
+	s->type = n.type;
+	s->which = n.which;
+	s->val = n.val;
+
+	if (n.type == STfunction)
+		for (int i = 0; i < Fset.nargs (n.which); ++i)
+			s->args[i] = extract (n.args[i], best);
+
+	return s;
+}
+
+// Saturate the e-graph of s and extract the smallest tree
+S_Expression *EGraph::simplify (S_Expression *s, int max_iterations)
+{
+	enodes.clear();
+	owner.clear();
+	eclasses.clear();
+	leader.clear();
+	memo.clear();
+
+	fiflte = find_function ("IFLTE");
+	fifltz = find_function ("IFLTZ");
+	fifdrop = find_function ("IF-DROP");
+	fadd = find_function ("+");
+	fsub = find_function ("-");
+	fmul = find_function ("*");
+	fdiv = find_function ("%");
+
+	int root = add_sexpression (s);
+	analyse();
+
+	for (int iter = 0; iter < max_iterations; ++iter)
+	{
+		changed = 0;
+
+		// Only visit the nodes that existed at the start of
+		// this pass; new ones are picked up by the next
+		int n = (int) enodes.size();
+
+		for (int i = 0; i < n && (int) enodes.size() < max_nodes; ++i)
+			apply_rules (i);
+
+		rebuild();
+		analyse();
+
+		if (!changed)
+			break;
+	}
+
+	vector<int> cost, best;
+	costs (cost, best);
+
+	return extract (root, best);
+}
+
+// Convenience wrapper around EGraph::simplify
+S_Expression *egraph_simplify (S_Expression *s)
+{
+	EGraph g;
+	return g.simplify (s);
+}
+
+// Report how much smaller and faster the population becomes
+void egraph_benchmark (GP *gp, int repeats)
+{
+	long before = 0, after = 0;
+	clock_t tbefore = 0, tafter = 0;
+	int depth, total, internal, external, hits;
+
+	for (int i = 0; i < gp->M; ++i)
+	{
+		S_Expression *s = gp->pop[i].s;
+
+		if (!s)
+			continue;
+
+		S_Expression *simplified = egraph_simplify (s);
+
+		s->characterize (&depth, &total, &internal, &external);
+		before += total;
+
+		simplified->characterize (&depth, &total, &internal, &external);
+		after += total;
+
+		clock_t t = clock();
+
+		for (int r = 0; r < repeats; ++r)
+		{
+			hits = 0;
+			(*gp->fitness_function) (s, &hits);
+		}
+
+		tbefore += clock() - t;
+		t = clock();
+
+		for (int r = 0; r < repeats; ++r)
+		{
+			hits = 0;
+			(*gp->fitness_function) (simplified, &hits);
+		}
+
+		tafter += clock() - t;
+
+		delete simplified;
+	}
+
+	cout << "\nE-graph simplification of generation " << gp->gen << ":\n";
+	cout << "Nodes: " << before << " -> " << after;
+
+	if (before)
+		cout << " (" << 100.0 * (before - after) / before << "% smaller)";
+
+	cout << "\nEvaluation time: " << (double) tbefore / CLOCKS_PER_SEC << "s -> " << (double) tafter / CLOCKS_PER_SEC << "s";
+
+	if (tafter)
+		cout << " (" << (double) tbefore / tafter << "x speedup)";
+
+	cout << "\n";
+	cout.flush();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef LIBGP_EGRAPH
+#define LIBGP_EGRAPH
+
+////////////////////////////////////////////////////////////
+// egraph.h -- equality saturation for S-Expressions
+//
+// Written by Jak R. Boulton, 2013
+// University of Glamorgam, Software Engineering
+////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////
+// An e-graph stores many equivalent programs at once.  Each
+// e-class is a set of e-nodes known to compute the same
+// value with the same side effects, and an e-node is a
+// function whose arguments are e-classes.  Rewrite rules
+// only ever add equalities, so after the rules stop finding
+// anything new ("saturation") the smallest tree in the
+// root's class is the smallest equivalent program we know.
+////////////////////////////////////////////////////////////
+
+#include "gp.h"
+
+#include <map>
+#include <vector>
+
+class EGraph
+{
+private:
+	struct ENode
+	{
+		SEXP_TYPE type;
+		int which; // index of terminal or function
+		float val; // value if type == STconstant
+		int args[MAX_SEXP_ARGS]; // e-class of each argument
+
+		bool operator< (const ENode& n) const;
+	};
+
+	struct EClass
+	{
+		std::vector<int> nodes; // indexes into enodes
+		int is_constant; // 1 == val is known
+		float val;
+		int pure; // 1 == has no side effects
+	};
+
+	std::vector<ENode> enodes;
+	std::vector<int> owner; // class each e-node was added to
+	std::vector<EClass> eclasses;
+	std::vector<int> leader; // union-find parent of each class
+	std::map<ENode, int> memo; // canonical e-node -> e-class
+	int changed; // did the last pass add an equality?
+
+	// Function indexes the rules know about (-1 == absent)
+	int fiflte, fifltz, fifdrop;
+	int fadd, fsub, fmul, fdiv;
+
+	// Union-find
+	int find (int c);
+	void merge (int a, int b);
+
+	// Add an e-node (arguments are e-classes), return its class
+	int add (ENode n);
+	int add_constant (float f);
+	int add_sexpression (S_Expression *s);
+
+	// Restore the invariants after merges, return 1 if any
+	// two e-nodes turned out to be congruent
+	int rebuild (void);
+
+	// Recompute the constant and purity facts of each class
+	void analyse (void);
+
+	// Apply every rule to one e-node
+	void apply_rules (int node);
+
+	// Best cost of each class, then the tree that costs it
+	void costs (std::vector<int>& cost, std::vector<int>& best);
+	S_Expression *extract (int c, std::vector<int>& best);
+
+public:
+	// Node limit, saturation stops growing the graph past it
+	int max_nodes;
+
+	// Constructor
+	EGraph (void);
+
+	// Return the smallest program equivalent to s.  s is left
+	// unchanged, the result is a new tree.
+	S_Expression *simplify (S_Expression *s, int max_iterations = 8);
+};
+
+#endif
@@ -37,7 +37,7 @@ FunctionSet::~FunctionSet (void)
 
 // Add a new function to the set
 //
-void FunctionSet::add (const char *name, int nargs, impfunc implementation, editfunc edit_function, int has_sides)
+void FunctionSet::add (const char *name, int nargs, impfunc implementation, editfunc edit_function, int has_sides, int passthrough)
 {
 	// First, check to see if the name is already in the list
 	for (int i = 0; i < n; ++i)
@@ -67,6 +67,7 @@ void FunctionSet::add (const char *name, int nargs, impfunc implementation, edit
 	functions[n].edit = edit_function;
 	functions[n].active = 1;
 	functions[n].side_effects = has_sides;
+	functions[n].passthrough = passthrough;
 	functions[n++].s = NULL;
 }
 
@@ -99,6 +100,7 @@ int FunctionSet::encapsulate (S_Expression *s, int nargs)
 	functions[n].edit = NULL;
 	functions[n].active = 1;
 	functions[n].side_effects = s->side_effects();
+	functions[n].passthrough = 0;
 	functions[n].s = s->copy();
 	cout << "\nEncapsulating " << buffer << " = " << functions[n].s << '\n';
 	cout.flush();
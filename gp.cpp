@@ -18,6 +18,9 @@
 #include "gp.h"
 #include "random.h"
 
+// Nobody is being scored incrementally yet
+Individual *evaluating = NULL;
+
 float default_ephemeral_generator (void)
 {
 	// Return a number between -1.0 and 1.0
@@ -38,6 +41,10 @@ GP::GP(FITNESSFUNC fitfun, int pop_size)
 	pm = 0;
 	pp = 0;
 	fed = 0;
+	discard_result = 0;
+	use_coverage = 0;
+	prune_introns = 0;
+	incremental = 0;
 	pen = 0;
 	dec_cond = NULL;
 	pd = 0;
@@ -48,6 +55,7 @@ GP::GP(FITNESSFUNC fitfun, int pop_size)
 	use_greedy_overselection = (G >= 1000);
 	overselection_boundary = (float)((G < 1000) ? 0.32 : (320 / M));
 	use_elitist_strategy = 0;
+	egraph_usage = EGRAPH_OFF;
 
 	// Set up housekeeping info
 	initialized = 0;
@@ -66,6 +74,7 @@ GP::GP(FITNESSFUNC fitfun, int pop_size)
 	verbose = QUIET;
 	termination_criteria = NULL;
 	fitness_function = fitfun;
+	full_fitness_function = NULL;
 	standardize_fitness = NULL;
 	sfit_dontreport = 1.0e20;
 	generation_callback = NULL;
@@ -158,6 +167,7 @@ void GP::list_parameters (void)
 		cout << "Mutation fraction: " << pm << '\n';
 		cout << "Permutation fraction: " << pp << '\n';
 		cout << "Encapsulation fraction: " << pen << '\n';
+		cout << "Editing frequency: " << fed << '\n';
 		cout << "Selection method: ";
 
 		switch (reproduction_selection)
@@ -304,6 +314,11 @@ void GP::nextgen (void)
 		if (! i && use_elitist_strategy)
 		{
 			newpop[i] = best_of_run;
+
+			// Its score is on every case, the others' on a sample
+			if (full_fitness_function)
+				newpop[i].recalc_needed = 1;
+
 			continue;
 		}
 
@@ -317,7 +332,26 @@ void GP::nextgen (void)
 			// Crossover operation
 			newpop[i+1] = pop[choose_random (this, second_parent_selection)];
 
-			crossover (&(newpop[i].s), &(newpop[i+1].s), pip);
+			// Each offspring runs as its parent did up to the code
+			// it was given, unless restricting its depth cuts code
+			// outside that too
+			if (incremental)
+			{
+				int depth1, depth2, total, internal, external;
+				newpop[i].s->characterize (&depth1, &total, &internal, &external);
+				newpop[i+1].s->characterize (&depth2, &total, &internal, &external);
+
+				crossover (&(newpop[i].s), &(newpop[i+1].s), pip, use_coverage,
+					&(newpop[i].diverge), &(newpop[i+1].diverge));
+
+				if (depth1 > Dcreated)
+					newpop[i].diverge = 0;
+
+				if (depth2 > Dcreated)
+					newpop[i+1].diverge = 0;
+			}
+			else
+				crossover (&(newpop[i].s), &(newpop[i+1].s), pip, use_coverage);
 
 			newpop[i].s->restrict_depth (Dcreated);
 			newpop[i].recalc_needed = 1;
@@ -332,20 +366,40 @@ void GP::nextgen (void)
 			int depth, total, internal, external, n = -1, m;
 			newpop[i].s->characterize (&depth, &total, &internal, &external);
 
-			m = (int) floor (total * random());
-			s = newpop[i].s->selectany (m, &n, &parentptr);
+			// Mutating code that never ran is a wasted evaluation
+			s = NULL;
+			parentptr = NULL;
+
+			if (use_coverage)
+				s = newpop[i].s->select_executed (&parentptr);
+
+			if (! s)
+			{
+				m = (int) floor (total * random());
+				s = newpop[i].s->selectany (m, &n, &parentptr);
+			}
 
 			if (! parentptr)
 				parentptr = &(newpop[i].s);
 
+			if (incremental)
+				newpop[i].diverge = s->first_run();
+
 			*parentptr = random_sexpression (GROW, 6);
 			delete s;
+
+			newpop[i].recalc_needed = 1;
 		}
 		else if (option <= (pc+pm+pp))
 		{
 			// Permutation operation
 			s = newpop[i].s->select (1.0, &parentptr);
+
+			if (incremental)
+				newpop[i].diverge = s->first_run();
+
 			s->permute();
+			newpop[i].recalc_needed = 1;
 		}
 		else if (option <= (pc+pm+pp+pen))
 		{
@@ -356,6 +410,10 @@ void GP::nextgen (void)
 			if (! parentptr)
 				parentptr = &(newpop[i].s);
 
+			// The program does the same, but the encapsulated code's
+			// counts are gone, so its offspring start from scratch
+			newpop[i].state.reset();
+
 			int e = Fset.encapsulate (s);
 
 			delete s;
@@ -386,7 +444,28 @@ void GP::eval_fitnesses (void)
 	{
 		if (pop[i].recalc_needed)
 		{
+			// Count how often each node runs during evaluation (the
+			// counts from before the program can differ from its
+			// parent's still hold)
+			if (use_coverage || prune_introns || incremental)
+			{
+				pop[i].s->reset_execs_from (pop[i].diverge);
+				S_Expression::profiling = 1;
+			}
+
+			if (incremental)
+				evaluating = &(pop[i]);
+
+			pop[i].hits = 0;
 			pop[i].rfit = (*fitness_function)(pop[i].s, &(pop[i].hits));
+			S_Expression::profiling = 0;
+			evaluating = NULL;
+
+			// Scored from the start from now on, unless changed
+			pop[i].diverge = 0;
+
+			if (prune_introns)
+				pop[i].s->prune_unexecuted();
 			
 			if (standardize_fitness)
 				pop[i].sfit = standardize_fitness (pop[i].rfit);
@@ -426,6 +505,8 @@ void GP::eval_fitnesses (void)
 	}
 
 	avgofgen_sfit /= (float)M;
+	egraph_population ();
+
 	float total = 0;
 
 	for (i = 0; i < M; ++i)
@@ -435,7 +516,27 @@ void GP::eval_fitnesses (void)
 		pop[i].sumnfit = total;
 	}
 
-	if (bestofgen_sfit < best_of_run.sfit)
+	// A score on a sample of the cases can't be compared with one
+	// on another sample, so rescore the best of generation on every
+	// case before it can become the best of run
+	if (full_fitness_function)
+	{
+		Individual &elite = pop[bestofgen_index];
+		int hits = 0;
+		float rfit = (*full_fitness_function)(elite.s, &hits);
+		float sfit = standardize_fitness ? standardize_fitness (rfit) : rfit;
+
+		if (sfit < best_of_run.sfit)
+		{
+			best_of_run = elite;
+			best_of_run.rfit = rfit;
+			best_of_run.sfit = sfit;
+			best_of_run.afit = 1.0 / (1.0 + sfit);
+			best_of_run.hits = hits;
+			bestofrun_gen = gen;
+		}
+	}
+	else if (bestofgen_sfit < best_of_run.sfit)
 	{
 		best_of_run = pop[bestofgen_index];
 		bestofrun_gen = gen;
@@ -445,6 +546,53 @@ void GP::eval_fitnesses (void)
 		fprintf (stat_file, "%d %g %g %g\n", gen, bestofgen_sfit, worstofgen_sfit, avgofgen_sfit);
 }
 
+// Simplify the whole population with the editing functions.
+// Editing never changes what a program does, so the fitness
+// measures already calculated stay valid.
+void GP::edit_population (void)
+{
+	for (int i = 0; i < M; ++i)
+	{
+		// The edited tree's counts no longer say when each node
+		// ran, so its offspring are scored from the start
+		pop[i].state.reset();
+		pop[i].s = edit (pop[i].s);
+
+		// Nobody looks at the value, drop the code computing it
+		if (discard_result)
+		{
+			pop[i].s = prune_unused (pop[i].s);
+			pop[i].s = edit (pop[i].s);
+		}
+	}
+}
+
+// Run the e-graph simplifier over the best of generation or
+// the whole population.  The simplified trees are equivalent,
+// so they keep their fitness measures.
+void GP::egraph_population (void)
+{
+	S_Expression *s;
+
+	if (egraph_usage == EGRAPH_BEST_OF_GEN)
+	{
+		s = egraph_simplify (pop[bestofgen_index].s);
+		delete pop[bestofgen_index].s;
+		pop[bestofgen_index].s = s;
+		pop[bestofgen_index].state.reset();
+	}
+	else if (egraph_usage == EGRAPH_POPULATION)
+	{
+		for (int i = 0; i < M; ++i)
+		{
+			s = egraph_simplify (pop[i].s);
+			delete pop[i].s;
+			pop[i].s = s;
+			pop[i].state.reset();
+		}
+	}
+}
+
 void GP::report_on_run (void)
 {
 	if (verbose & END_REPORT)
@@ -497,6 +645,9 @@ void GP::go(int maxgens)
 		if (gen > 0)
 			nextgen ();
 
+		if (fed && gen > 0 && !(gen % fed))
+			edit_population ();
+
 		if (verbose & GENERATION_UPDATE)
 		{
 			cout << "\rGeneration " << gen << ' ';
@@ -18,9 +18,33 @@
 
 #include <iostream>
 #include <sstream>
+#include <memory>
+#include <climits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 using namespace std;
 
+///////////////////////////////////////////////////////////
+// Support for evaluating one program on several threads
+///////////////////////////////////////////////////////////
+
+// Storage that each thread has its own copy of
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define GP_THREAD_LOCAL __declspec(thread)
+#else
+#define GP_THREAD_LOCAL thread_local
+#endif
+
+// Add one to a long that other threads may be adding to
+#ifdef _MSC_VER
+#define GP_ATOMIC_INCREMENT(x) _InterlockedIncrement (&(x))
+#else
+#define GP_ATOMIC_INCREMENT(x) __sync_fetch_and_add (&(x), 1)
+#endif
+
 ///////////////////////////////////////////////////////////
 // Some type declarations and forward declarations
 ///////////////////////////////////////////////////////////
@@ -47,12 +71,18 @@ enum GenerativeMethod { GROW, FULL, RAMPED_HALF_AND_HALF };
 // Maximum number of arguments to an S-Expression function
 #define MAX_SEXP_ARGS 4
 
+// S_Expression::first_run of a node that never ran
+#define NEVER_RAN LONG_MAX
+
 // Fitness evaluation function
 typedef float (*FITNESSFUNC)(S_Expression *s, int *hits);
 
 // Methods of selecting individuals for reproduction
 enum SelectionMethod { UNIFORM, FITNESS_PROPORTIONATE, TOURNAMENT, RANK };
 
+// Which individuals the e-graph simplifier (egraph.h) rewrites
+enum EGraphUsage { EGRAPH_OFF, EGRAPH_BEST_OF_GEN, EGRAPH_POPULATION };
+
 // Types of fitness measures
 enum FitnessMeasure { RAW, ADJUSTED };
 
@@ -101,19 +131,28 @@ public:
 
 	// Modify the value of a terminal specified by index
 	void modify (const int index, float val)
-	{ terminals[index].val = val; }
+	{ if (frame) frame[index] = val; else terminals[index].val = val; }
 
 	// Retrieve the value of a terminal specified by name
 	float get (const char *name);
 
 	// Look up the value based on the index number
-	float get (int ind) { return terminals[ind].val; }
+	float get (int ind) { return frame ? frame[ind] : terminals[ind].val; }
 
 	// Return the index number for the named terminal
 	int index (const char *name);
 
 	// Look up the value based on the index number
-	float lookup (int ind) { return terminals[ind].val; }
+	float lookup (int ind) { return frame ? frame[ind] : terminals[ind].val; }
+
+	// When a thread sets a frame (n values, one per terminal)
+	// its reads and writes of terminal values go there instead,
+	// so threads can run the same program at the same time.
+	static GP_THREAD_LOCAL float *frame;
+
+	// Copy the current values into a thread's frame
+	void fill_frame (float *values)
+	{ for (int i = 0; i < n; ++i) values[i] = terminals[i].val; }
 
 	// Look up the name based on the index number
 	char *getname (int ind) { return terminals[ind].name; }
@@ -140,6 +179,7 @@ private:
 		editfunc edit; // The editing function
 		int active; // 0 == don't use this function
 		int side_effects; // 1 == has side effects
+		int passthrough; // bit i set == arg i may be returned
 		S_Expression *s; // non-NULL means that it's
 						// encapsulated function.
 	};
@@ -155,7 +195,7 @@ public:
 	~FunctionSet (void);
 
 	// Add a new function to the set
-	void add (const char *name, int nargs, impfunc implementation, editfunc edit_function = NULL, int has_sides = 0);
+	void add (const char *name, int nargs, impfunc implementation, editfunc edit_function = NULL, int has_sides = 0, int passthrough = 0);
 
 	// Add a new function which executes an S-Expression
 	int encapsulate (S_Expression *s, int nargs = 0);
@@ -189,6 +229,11 @@ public:
 	int has_sideeffects (int ind)
 	{ return functions[ind].side_effects; }
 
+	// Return 1 if the indexed function can return the value
+	// of its argument arg (the condition args of an IF can't)
+	int passes_through (int ind, int arg)
+	{ return (functions[ind].passthrough >> arg) & 1; }
+
 	// Return a pointer to indexed function implementation
 	impfunc lookup_implementation (int ind)
 	{ return functions[ind].func; }
@@ -221,9 +266,20 @@ public:
 	SEXP_TYPE type;
 	float val; // value if type == STconstant
 	int which; // index of terminal or function
+	long execs; // times evaluated while profiling
+	long first; // clock when first evaluated (if execs)
 
 	S_Expression* args[MAX_SEXP_ARGS];
 
+	// 1 == count executions of each node in eval(),
+	// 2 == count them safely from several threads at once
+	static int profiling;
+
+	// Where the fitness function's simulation is up to (it sets
+	// it, say to the number of steps taken), so each node knows
+	// when it first ran.  Not kept when profiling == 2.
+	static long clock;
+
 	// Constructor
 	S_Expression();
 
@@ -239,6 +295,14 @@ public:
 	{
 		float f;
 
+		if (profiling)
+		{
+			if (profiling > 1)
+				GP_ATOMIC_INCREMENT (execs);
+			else if (! execs++)
+				first = clock;
+		}
+
 		if (type == STfunction) 
 		{
 			if (Fset.is_encapsulated (which))
@@ -274,6 +338,10 @@ public:
 	// Edit the tree (destructively), return ptr to new root
 	friend S_Expression *edit(S_Expression *s);
 
+	// Replace code whose value is never used and which has no
+	// side effects with a constant (destructively)
+	friend S_Expression *prune_unused(S_Expression *s);
+
 	// Permute the arguments of this functional S-Expression
 	void permute (void);
 
@@ -292,14 +360,32 @@ public:
 	// Does the tree below have functions with side effects?
 	int side_effects(void);
 
+	// Execution coverage: zero the counts, count the nodes
+	// that ran, and cut off the subtrees that never did
+	void reset_execs(void);
+	int executed(void);
+	void prune_unexecuted(void);
+
+	// Clock this node first ran at (NEVER_RAN if it didn't)
+	long first_run(void) { return execs ? first : NEVER_RAN; }
+
+	// Zero the counts of the nodes that first ran at or after
+	// from, keep the earlier ones
+	void reset_execs_from(long from);
+
 	// Select points
 	S_Expression * selectany(int, int *, S_Expression ***ptr);
 	S_Expression * selectinternal(int, int *, S_Expression ***ptr);
 	S_Expression * selectexternal(int, int *, S_Expression ***ptr);
 	S_Expression * select(float pip, S_Expression ***ptr);
+	S_Expression * selectexecuted(int, int *, S_Expression ***ptr);
+	S_Expression * select_executed(S_Expression ***ptr);
 
-	// Perform crossover operation
-	friend void crossover (S_Expression **s1, S_Expression **s2, float pip);
+	// Perform crossover operation, optionally only at points
+	// that were executed during the last fitness evaluation.
+	// diverge1/2 get the clock each tree first ran the code it
+	// lost at (the swapped code's counts are zeroed).
+	friend void crossover (S_Expression **s1, S_Expression **s2, float pip, int executed_only = 0, long *diverge1 = NULL, long *diverge2 = NULL);
 
 	// Make a random tree
 	friend S_Expression *random_sexpression(GenerativeMethod strategy, int maxdepth=6, int depth=0);
@@ -334,6 +420,13 @@ public:
 	int hits; // Number of hits
 	int recalc_needed; // Do we need to recalculate?
 
+	// Incremental evaluation: what the fitness function saved
+	// while scoring this program (shared by its copies), and
+	// the clock before which the program runs the same as the
+	// one that saved it (0 == it may differ from the start)
+	shared_ptr<void> state;
+	long diverge;
+
 	// Constructor and destructor
 	Individual (void)
 	{
@@ -344,6 +437,7 @@ public:
 		nfit = 0;
 		hits = 0;
 		recalc_needed = 1;
+		diverge = 0;
 	}
 	~Individual (void) { if (s) delete s; }
 
@@ -362,9 +456,16 @@ public:
 		sumnfit = i.sumnfit;
 		hits = i.hits;
 		recalc_needed = i.recalc_needed;
+		state = i.state;
+		diverge = i.diverge;
 	}
 };
 
+// The individual being scored when the GP is incremental (its
+// state and diverge say where the fitness function can resume
+// from, and it leaves the state for its offspring), else NULL
+extern Individual *evaluating;
+
 
 class GP
 {
@@ -380,6 +481,11 @@ public:
 	float pm; // Probability of mutation
 	float pp; // Probability of permutation
 	int fed; // Frequency of performing editing
+	int use_coverage; // 1 == vary only executed code
+	int prune_introns; // 1 == cut code that never executed
+	int discard_result; // 1 == fitness ignores the returned value
+	int incremental; // 1 == offspring note where they part from
+					// their parent (the cases must stay the same)
 	float pen; // Probability of encapsulation
 	CONDITION dec_cond; // Condition for decimation
 	float pd; // Decimation percentage
@@ -390,6 +496,7 @@ public:
 	int use_greedy_overselection;
 	float overselection_boundary;
 	int use_elitist_strategy;
+	EGraphUsage egraph_usage;
 
 	// Number to use when using tournament selection
 	int tournament_size;
@@ -410,6 +517,8 @@ public:
 	// User-defined funcs for controlling the GP run and I/O
 	int verbose;
 	FITNESSFUNC fitness_function; // The fitness evaluation function
+	FITNESSFUNC full_fitness_function; // Fitness on every case, when
+									// fitness_function scores a sample
 	CONDITION termination_criteria; // When do we terminate?
 	FLOATFUNC standardize_fitness; // Fitness standardization
 	float sfit_dontreport; // Don't report fitness >= this
@@ -448,6 +557,12 @@ private:
 	// Calculate fitnesses & stats
 	void eval_fitnesses (void);
 
+	// Simplify every individual with the editing functions
+	void edit_population (void);
+
+	// Replace individuals by their smallest equivalent trees
+	void egraph_population (void);
+
 	// Print some end-of-run statistics
 	void report_on_run (void);
 
@@ -478,4 +593,27 @@ void use_du (void);
 extern int max_du_iterations;
 void use_setsv (void);
 
+
+////////////////////////////////////////////////////////////
+// Canned editing functions for the conditionals, found in
+// edit.cpp.  Each one simplifies a single node whose
+// arguments have already been edited.
+////////////////////////////////////////////////////////////
+
+S_Expression *edit_iflte (S_Expression *s);
+S_Expression *edit_ifltz (S_Expression *s);
+
+
+////////////////////////////////////////////////////////////
+// Equality saturation simplifier, found in egraph.cpp
+////////////////////////////////////////////////////////////
+
+// Return the smallest program equivalent to s (a new tree)
+S_Expression *egraph_simplify (S_Expression *s);
+
+// Simplify every individual in the population and report the
+// node-count reduction and the change in fitness evaluation
+// time (each program is evaluated repeats times).
+void egraph_benchmark (GP *gp, int repeats = 10);
+
 #endif
\ No newline at end of file
@@ -20,12 +20,20 @@ using namespace std;
 
 static S_Expression *free_list = NULL;
 
+// Execution counting is off unless the GP asks for it
+int S_Expression::profiling = 0;
+
+// The fitness function moves the clock on
+long S_Expression::clock = 0;
+
 // Constructor
 S_Expression::S_Expression (void)
 {
 	type = STnone;
 	val = 0;
 	which = 0;
+	execs = 0;
+	first = 0;
 
 	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
 		args[i] = NULL;
@@ -91,6 +99,31 @@ S_Expression *edit (S_Expression *s)
 	return s;
 }
 
+// Replace side-effect-free code whose value is never used
+// by a constant, then return new expr.  Only the arguments
+// a function can pass back as its own value are followed;
+// everything else (e.g. the condition of an IF) is used.
+S_Expression *prune_unused (S_Expression *s)
+{
+	if (!s || s->type == STconstant)
+		return s;
+
+	if (! s->side_effects())
+	{
+		delete s;
+		s = new S_Expression;
+		s->type = STconstant;
+		s->val = 0;
+		return s;
+	}
+
+	for (int i = 0; i < Fset.nargs (s->which); ++i)
+		if (Fset.passes_through (s->which, i))
+			s->args[i] = prune_unused (s->args[i]);
+
+	return s;
+}
+
 // Perform permutation on a random node in this S-expression
 void S_Expression::permute (void)
 {
@@ -121,6 +154,8 @@ S_Expression * S_Expression::copy (void)
 	se->type = type;
 	se->val = val;
 	se->which = which;
+	se->execs = execs;
+	se->first = first;
 
 	for (int i = 0; i < MAX_SEXP_ARGS; ++i)
 		if (args[i])
@@ -241,6 +276,69 @@ int S_Expression::side_effects (void)
 	return 0;
 }
 
+// Zero the execution counts of the whole tree
+void S_Expression::reset_execs (void)
+{
+	execs = 0;
+
+	if (type == STfunction)
+		for (int i = 0; i < Fset.nargs (which); ++i)
+			args[i]->reset_execs();
+}
+
+// Zero the counts of the nodes that first ran at or after from.
+// A node can only run after its parent did, so once one is
+// zeroed so are all of its children.
+void S_Expression::reset_execs_from (long from)
+{
+	if (execs && first < from)
+	{
+		if (type == STfunction)
+			for (int i = 0; i < Fset.nargs (which); ++i)
+				args[i]->reset_execs_from (from);
+	}
+	else
+		reset_execs();
+}
+
+// Return the number of nodes that were executed
+int S_Expression::executed (void)
+{
+	int n = 0;
+
+	if (! execs)
+		return 0;
+
+	if (type == STfunction)
+		for (int i = 0; i < Fset.nargs (which); ++i)
+			n += args[i]->executed();
+
+	return n + 1;
+}
+
+// Replace every argument that never executed with a
+// constant.  Only meaningful after a profiled evaluation;
+// on a deterministic problem the program still does the
+// same thing on its fitness cases.
+void S_Expression::prune_unexecuted (void)
+{
+	if (type != STfunction || ! execs)
+		return;
+
+	for (int i = 0; i < Fset.nargs (which); ++i)
+	{
+		if (args[i]->execs)
+			args[i]->prune_unexecuted();
+		else if (args[i]->type != STconstant)
+		{
+			delete args[i];
+			args[i] = new S_Expression;
+			args[i]->type = STconstant;
+			args[i]->val = 0;
+		}
+	}
+}
+
 S_Expression * S_Expression::selectany (int m, int *n, S_Expression ***ptr)
 {
 	(*n)++;
@@ -348,15 +446,67 @@ S_Expression * S_Expression::select (float pip, S_Expression ***ptr)
 	}
 }
 
+// Select the m'th executed node (in preorder).  Unexecuted
+// nodes can only have unexecuted children, so skip them.
+S_Expression * S_Expression::selectexecuted (int m, int *n, S_Expression ***ptr)
+{
+	if (! execs)
+		return NULL;
+
+	(*n)++;
+
+	if (*n == m)
+		return (this);
+
+	if (type == STfunction)
+	{
+		int nargs = Fset.nargs (which);
+
+		for (int i = 0; i < nargs; ++i)
+		{
+			S_Expression *s = args[i]->selectexecuted (m, n, ptr);
+
+			if (s)
+			{
+				if (args[i] == s)
+					*ptr = &(args[i]);
+
+				return s;
+			}
+		}
+	}
+	return NULL;
+}
+
+// Select a random executed node, NULL if none ran
+S_Expression * S_Expression::select_executed (S_Expression ***ptr)
+{
+	int n = -1;
+	int total = executed();
+
+	*ptr = NULL;
+
+	if (! total)
+		return NULL;
+
+	return selectexecuted ((int) floor (random() * total), &n, ptr);
+}
+
 // Perform the crossover between these two S-Expressions
-void crossover(S_Expression **s1, S_Expression **s2, float pip)
+void crossover(S_Expression **s1, S_Expression **s2, float pip, int executed_only, long *diverge1, long *diverge2)
 {
 	S_Expression **parent1ptr = NULL, **parent2ptr = NULL;
-	S_Expression *fragment1, *fragment2;
+	S_Expression *fragment1 = NULL, *fragment2;
 
 	//char buffer[1024];
 
-	fragment1 = (*s1)->select (pip, &parent1ptr);
+	// Changing code that never runs can't change the fitness,
+	// so prefer the points that did run when asked to
+	if (executed_only)
+		fragment1 = (*s1)->select_executed (&parent1ptr);
+
+	if (! fragment1)
+		fragment1 = (*s1)->select (pip, &parent1ptr);
 
 	if (! parent1ptr)
 		parent1ptr = s1;
@@ -366,6 +516,20 @@ void crossover(S_Expression **s1, S_Expression **s2, float pip)
 	if (! parent2ptr)
 		parent2ptr = s2;
 
+	// Each tree runs as before until it reaches the swapped code,
+	// whose counts belong to the other tree
+	if (diverge1 || diverge2)
+	{
+		if (diverge1)
+			*diverge1 = fragment1->first_run();
+
+		if (diverge2)
+			*diverge2 = fragment2->first_run();
+
+		fragment1->reset_execs();
+		fragment2->reset_execs();
+	}
+
 	cout.flush();
 	*parent1ptr = fragment2;
 	*parent2ptr = fragment1;
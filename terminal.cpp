@@ -69,7 +69,7 @@ void TerminalSet::modify (const char *name, float val)
 	{
 		if (! strcmp (terminals[i].name, name))
 		{
-			terminals[i].val = val;
+			modify (i, val);
 			return;
 		}
 	}
@@ -83,7 +83,7 @@ float TerminalSet::get (const char *name)
 {
 	for (int i = 0; i < n; ++i)
 		if (! strcmp (terminals[i].name, name))
-			return terminals[i].val;
+			return get (i);
 	
 	// Oops! We didn't find the terminal
 	cout << "TerminalSet Error: could not find terminal: " << name << '\n';
@@ -115,5 +115,8 @@ void TerminalSet::print (void)
 	cout << '\n';
 }
 
+// No thread has its own frame until it sets one
+GP_THREAD_LOCAL float *TerminalSet::frame = NULL;
+
 // Declaration for the globally visible terminal set
 TerminalSet Tset;
\ No newline at end of file